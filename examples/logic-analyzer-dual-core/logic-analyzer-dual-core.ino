@@ -0,0 +1,42 @@
+/**
+ * @file logic-analyzer-dual-core.ino
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Arduino Sketch for the sigrok LogicAnalyzer for the ESP32 and the Raspberry Pico which is sampling with both cores
+ * See https://sigrok.org/wiki/Openbench_Logic_Sniffer#Short_Commands * 
+ */
+
+#include "Arduino.h"
+#include "capture_dual_core.h"
+
+using namespace logic_analyzer;  
+
+int pinStart=START_PIN;
+int numberOfPins=PIN_COUNT;
+LogicAnalyzer logicAnalyzer;
+DualCoreCapture capture(MAX_FREQ, MAX_FREQ_THRESHOLD);
+
+/// Generates a test PWM signal which is used for the calibration
+void activateTestSignal(int testPin, float dutyCyclePercent) {
+    pinMode(testPin, OUTPUT);
+    int value = dutyCyclePercent / 100.0 * 255.0;
+    analogWrite(testPin, value);
+}
+
+void setup() {
+    Serial.begin(SERIAL_SPEED);  
+    Serial.setTimeout(SERIAL_TIMEOUT);
+
+    logicAnalyzer.setDescription(DESCRIPTION);
+    logicAnalyzer.begin(Serial, &capture, MAX_CAPTURE_SIZE, pinStart, numberOfPins);
+
+    // determine the start delay of the second core with some activity on the first pin
+    activateTestSignal(pinStart, 50.0);
+    capture.calibrate();
+    analogWrite(pinStart, 0);
+    pinMode(pinStart, INPUT);
+}
+
+void loop() {
+    if (Serial) logicAnalyzer.processCommand();
+}
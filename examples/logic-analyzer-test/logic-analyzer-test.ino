@@ -7,6 +7,8 @@
 
 #include "Arduino.h"
 #define LOG Serial
+// activate the cycle probes to print the breakdown per capturing stage 
+//#define LOGIC_ANALYZER_PROBES
 #include "logic_analyzer.h"
 #include "capture_raspberry_pico.h"
 
@@ -155,6 +157,32 @@ void testFrequencyMaxSpeed(LogicAnalyzer &logicAnalyzer, Capture &capture){
     printLine();
 }
 
+// writes n single bytes and returns the throughput in bytes per second
+float measureOutput(Stream &out, size_t n){
+    uint64_t start = micros();
+    for (size_t j=0;j<n;j++){
+        out.write('-');
+    }
+    out.flush();
+    uint64_t end = micros();
+    Serial.println();
+    return 1000000.0 * n / (end - start);
+}
+
+// Compare the single byte output of the Serial with the BufferedStream
+void testBufferedOutput() {
+    const size_t n = 2000;
+    float unbuffered = measureOutput(Serial, n);
+    BufferedStream buffered(Serial);
+    float result = measureOutput(buffered, n);
+    Serial.print("output bytes/sec: ");
+    Serial.print(unbuffered);
+    Serial.print(" -> buffered: ");
+    Serial.print(result);
+    printOK(result >= unbuffered);
+    printLine();
+}
+
 /// test for all non pio tests
 void testAll() {
     logicAnalyzer.begin(Serial, &capture, MAX_CAPTURE_SIZE, pinStart, numberOfPins);
@@ -163,6 +191,7 @@ void testAll() {
     testPins(logicAnalyzer, capture);
     testBufferSize(logicAnalyzer);
     testSingleSample(logicAnalyzer, capture);
+    testBufferedOutput();
 
     activateTestSignal(logicAnalyzer.startPin(), duty_cycle_percent);
     delay(100);
@@ -220,6 +249,15 @@ void testAllPIO() {
 
 #endif    
 
+// Prints the cycles per capturing stage
+void printProbes() {
+#ifdef LOGIC_ANALYZER_PROBES
+    Serial.println("cycles per stage:");
+    probes.printTo(Serial);
+    printLine();
+#endif
+}
+
 void setup() {
     Serial.begin(115200);  
     //Logger.begin(Serial, PicoLogger::Debug);
@@ -231,11 +269,15 @@ void setup() {
     Serial.println("setup");
 
 #ifdef REGULAR_TEST
+    probes.clear();
     testAll();
+    printProbes();
 #endif
 
 #ifdef TEST_PIO
+    probes.clear();
     testAllPIO();
+    printProbes();
 #endif    
 
 }
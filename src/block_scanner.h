@@ -0,0 +1,289 @@
+/**
+ * @file block_scanner.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Word parallel evaluation of blocks of captured data
+ */
+#pragma once
+
+#include "Arduino.h"
+#include "config.h"
+
+// Max number of stages of a trigger sequence
+#ifndef BLOCK_SCANNER_MAX_STAGES
+#define BLOCK_SCANNER_MAX_STAGES 4
+#endif
+
+namespace logic_analyzer {
+
+/**
+ * @brief Searches blocks of captured data for a trigger condition. The trigger is a sequence of stages which
+ * need to match one after the other: a stage is either a pattern ((sample & mask) == value) or an edge, which
+ * matches when the masked sample is changing to the value. Multiple samples are packed into one 32 bit word, so
+ * that all of them are compared with a few instructions: the matching samples are determined with the
+ * "has zero byte" bit trick. The state (actual stage and last sample) is kept between the blocks.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class BlockScanner {
+    public:
+        /// Default Constructor
+        BlockScanner() {
+        }
+
+        /// Removes all stages: without any stage the first sample is matching
+        void clear() {
+            stage_count = 0;
+            reset();
+        }
+
+        /// Defines a single pattern stage
+        void setPattern(PinBitArray mask, PinBitArray value) {
+            clear();
+            addPattern(mask, value);
+        }
+
+        /// Defines a single edge stage
+        void setEdge(PinBitArray mask, PinBitArray value) {
+            clear();
+            addEdge(mask, value);
+        }
+
+        /// Adds a stage which matches when (sample & mask) == value
+        bool addPattern(PinBitArray mask, PinBitArray value) {
+            return addStage(mask, value, false);
+        }
+
+        /// Adds a stage which matches when the masked sample is changing to the value: e.g. use mask=value=1 for a rising edge on the first channel
+        bool addEdge(PinBitArray mask, PinBitArray value) {
+            return addStage(mask, value, true);
+        }
+
+        /// Provides the number of defined stages
+        int stageCount() {
+            return stage_count;
+        }
+
+        /// Restarts the sequence with the first stage
+        void reset() {
+            stage = 0;
+            has_last = false;
+        }
+
+        /// Provides the position of the sample which completes the trigger sequence in the block or -1 if there is no match
+        long scan(const PinBitArray *data, size_t n) {
+            if (stage_count==0) return n>0 ? 0 : -1;
+            size_t pos = 0;
+            // the first sample has no predecessor
+            if (!has_last && n>0){
+                if (matchesSample(stages[stage], data[0], data[0]) && nextStage()){
+                    last = data[0];
+                    has_last = true;
+                    return 0;
+                }
+                last = data[0];
+                has_last = true;
+                pos = 1;
+            }
+            if (sizeof(PinBitArray) <= sizeof(uint32_t)){
+                while (pos + lanes <= n){
+                    uint32_t word;
+                    memcpy(&word, data + pos, sizeof(uint32_t));
+                    // the predecessors of the samples in the word
+                    uint32_t prev = lanes==1 ? (uint32_t) last : (word << (lane_bits & 31)) | (uint32_t) last;
+                    uint32_t hits = matchesWord(stages[stage], word, prev);
+                    if (hits){
+                        size_t lane = __builtin_ctz(hits) / lane_bits;
+                        last = data[pos + lane];
+                        if (nextStage()) return pos + lane;
+                        // continue with the next stage after the matching sample
+                        pos += lane + 1;
+                        continue;
+                    }
+                    last = data[pos + lanes - 1];
+                    pos += lanes;
+                }
+            }
+            // remaining samples
+            for (; pos<n; pos++){
+                bool is_match = matchesSample(stages[stage], data[pos], last);
+                last = data[pos];
+                if (is_match && nextStage()) return pos;
+            }
+            return -1;
+        }
+
+    protected:
+        /// Definition of a stage with the replicated values for the word parallel processing
+        struct Stage {
+            PinBitArray mask;
+            PinBitArray value;
+            uint32_t mask_word;
+            uint32_t value_word;
+            bool is_edge;
+        };
+        static constexpr int lane_bits = sizeof(PinBitArray) >= sizeof(uint32_t) ? 32 : sizeof(PinBitArray) * 8;
+        static constexpr int lanes = 32 / lane_bits;
+        Stage stages[BLOCK_SCANNER_MAX_STAGES];
+        int stage_count = 0;
+        int stage = 0;
+        PinBitArray last = 0;
+        bool has_last = false;
+
+        bool addStage(PinBitArray mask, PinBitArray value, bool isEdge) {
+            if (stage_count >= BLOCK_SCANNER_MAX_STAGES) return false;
+            Stage &s = stages[stage_count++];
+            s.mask = mask;
+            s.value = value & mask;
+            s.mask_word = replicate(mask);
+            s.value_word = replicate(s.value);
+            s.is_edge = isEdge;
+            reset();
+            return true;
+        }
+
+        /// moves to the next stage: returns true if the sequence has been completed
+        bool nextStage() {
+            if (++stage < stage_count) return false;
+            stage = 0;
+            return true;
+        }
+
+        static bool matchesSample(Stage &s, PinBitArray sample, PinBitArray prev) {
+            if ((sample & s.mask) != s.value) return false;
+            return !s.is_edge || (prev & s.mask) != s.value;
+        }
+
+        /// Provides the high bit of each lane of the word which matches the stage
+        static uint32_t matchesWord(Stage &s, uint32_t word, uint32_t prev) {
+            uint32_t hits = zeroLanes((word ^ s.value_word) & s.mask_word);
+            if (s.is_edge){
+                hits &= ~zeroLanes((prev ^ s.value_word) & s.mask_word);
+            }
+            return hits;
+        }
+
+        /// Sets the high bit of each lane which is zero
+        static uint32_t zeroLanes(uint32_t x) {
+            const uint32_t low = replicate((PinBitArray)~((PinBitArray)1 << (lane_bits - 1)));
+            return ~(((x & low) + low) | x | low);
+        }
+
+        /// Copies the value into all lanes of a word
+        static constexpr uint32_t replicate(PinBitArray value) {
+            // single return, so that it is also a valid C++11 constexpr
+            return (uint32_t) value * (uint32_t)(0xFFFFFFFFull / ((1ull << lane_bits) - 1));
+        }
+};
+
+/**
+ * @brief Activity statistics of captured data: number of edges and minimum pulse width in samples per channel. 
+ * Words of samples without any change are skipped with a single comparison, so that only the changes are 
+ * evaluated channel by channel. The state is kept between the blocks.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class BlockStatistics {
+    public:
+        /// Default Constructor
+        BlockStatistics() {
+            reset();
+        }
+
+        /// Removes all collected data
+        void reset() {
+            sample_count = 0;
+            has_last = false;
+            for (int j=0; j<channels; j++){
+                edge_count[j] = 0;
+                last_edge[j] = 0;
+                min_width[j] = 0;
+            }
+        }
+
+        /// Adds a block of samples
+        void add(const PinBitArray *data, size_t n) {
+            size_t pos = 0;
+            if (!has_last && n>0){
+                last = data[0];
+                has_last = true;
+                pos = 1;
+            }
+            if (sizeof(PinBitArray) < sizeof(uint32_t)){
+                // skip words w/o any change
+                while (pos + lanes <= n){
+                    uint32_t word;
+                    memcpy(&word, data + pos, sizeof(uint32_t));
+                    uint32_t prev = (word << (lane_bits & 31)) | (uint32_t) last;
+                    if (word != prev){
+                        for (int j=0; j<lanes; j++){
+                            addSample(data[pos + j], sample_count + pos + j);
+                        }
+                    }
+                    last = data[pos + lanes - 1];
+                    pos += lanes;
+                }
+            }
+            for (; pos<n; pos++){
+                addSample(data[pos], sample_count + pos);
+            }
+            sample_count += n;
+        }
+
+        /// Provides the number of edges of the indicated channel
+        size_t edges(int channel) {
+            return edge_count[channel];
+        }
+
+        /// Provides the minimum number of samples between two edges of the indicated channel: 0 if there were less than 2 edges
+        size_t minPulseWidth(int channel) {
+            return min_width[channel];
+        }
+
+        /// Provides the minimum pulse width over all channels: 0 if no channel had 2 edges
+        size_t minPulseWidth() {
+            size_t result = 0;
+            for (int j=0; j<channels; j++){
+                if (min_width[j] > 0 && (result == 0 || min_width[j] < result)){
+                    result = min_width[j];
+                }
+            }
+            return result;
+        }
+
+        /// Provides the number of evaluated samples
+        size_t samples() {
+            return sample_count;
+        }
+
+    protected:
+        static const int channels = sizeof(PinBitArray) * 8;
+        static constexpr int lane_bits = sizeof(PinBitArray) >= sizeof(uint32_t) ? 32 : sizeof(PinBitArray) * 8;
+        static constexpr int lanes = 32 / lane_bits;
+        size_t edge_count[channels];
+        size_t last_edge[channels];
+        size_t min_width[channels];
+        size_t sample_count = 0;
+        PinBitArray last = 0;
+        bool has_last = false;
+
+        /// updates the statistics with the sample at the indicated position
+        void addSample(PinBitArray sample, size_t pos) {
+            PinBitArray changes = sample ^ last;
+            last = sample;
+            while (changes){
+                int channel = __builtin_ctzll((unsigned long long) changes);
+                changes &= changes - 1;
+                if (edge_count[channel] > 0){
+                    size_t width = pos - last_edge[channel];
+                    if (min_width[channel] == 0 || width < min_width[channel]){
+                        min_width[channel] = width;
+                    }
+                }
+                last_edge[channel] = pos;
+                edge_count[channel]++;
+            }
+        }
+};
+
+} // namespace
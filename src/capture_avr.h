@@ -0,0 +1,165 @@
+/**
+ * @file capture_avr.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief AVR specific burst capturing with cycle counted assembler loops
+ */
+#pragma once
+
+#ifdef AVR
+
+#include "logic_analyzer.h"
+
+// Port which is sampled in burst mode: PIND are the pins 0 to 7 which are also read by the PinReader with start pin 0
+#ifndef AVR_BURST_PORT
+#define AVR_BURST_PORT PIND
+#endif
+
+// Number of unrolled samples at the highest rate: this needs 6 bytes of flash per sample
+#ifndef AVR_BURST_SIZE
+#define AVR_BURST_SIZE MAX_CAPTURE_SIZE
+#endif
+
+namespace logic_analyzer {
+
+/**
+ * @brief Captures one port with interrupts disabled in cycle counted assembler loops at the fixed rates F_CPU/4
+ * (fully unrolled), F_CPU/8 and F_CPU/16: this is 4, 2 and 1 MHz on a 16 MHz board. The trigger is evaluated with
+ * interrupts disabled as well and the capturing starts at the trigger, so there is no pre-trigger history.
+ * All other frequencies and the continuous capturing are handled by the generic Capture implementation.
+ * The channels are the bits of the AVR_BURST_PORT: with the default PIND these are the same channels as in the 
+ * generic Capture with the start pin 0, so the burst mode is only used with this start pin.
+ * The sampling periods are derived from the instruction timings of the datasheet: they have not been verified 
+ * in a simulator (e.g. simavr) or with a scope yet.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AVRBurstCapture : public Capture {
+    public:
+        /// Default Constructor
+        AVRBurstCapture(uint64_t maxCaptureFreq, uint64_t maxCaptureFreqThreshold) : Capture(maxCaptureFreq, maxCaptureFreqThreshold) {
+        }
+
+        /// starts the capturing of the data
+        virtual void capture() override {
+            uint8_t cycles = cyclesPerSample(la_state.frequecy_value);
+            if (cycles==0 || la_state.is_continuous_capture || la_state.pin_start != 0 || la_state.read_count == 0 || buffer_ptr->size() < AVR_BURST_SIZE){
+                Capture::capture();
+                return;
+            }
+            log("capture burst with %d cycles per sample", cycles);
+            size_t count = la_state.read_count < AVR_BURST_SIZE ? la_state.read_count : AVR_BURST_SIZE;
+            PinBitArray *data = buffer_ptr->data_ptr();
+            bool is_triggered = true;
+
+            noInterrupts();
+            if (la_state.trigger_mask){
+                is_triggered = waitForTriggerBurst(la_state.trigger_mask, la_state.trigger_values);
+            }
+            if (is_triggered){
+                switch(cycles){
+                    case 4:
+                        burstUnrolled(data);
+                        break;
+                    case 8:
+                        burstLoop<1>(data, count);
+                        break;
+                    default:
+                        burstLoop<9>(data, count);
+                        break;
+                }
+            }
+            interrupts();
+
+            if (!is_triggered){
+                // the received command is processed by processCommand()
+                log("capture aborted");
+                setStatus(STOPPED);
+                return;
+            }
+            la_state.setStatus(TRIGGERED);
+            buffer_ptr->clear();
+            buffer_ptr->setAvailable(count);
+            dumpResult();
+        }
+
+        /// Provides the cycles per sample for the requested frequency: 0 if it is not supported in burst mode
+        static uint8_t cyclesPerSample(uint32_t frequency) {
+            for (uint8_t cycles=4; cycles<=16; cycles*=2){
+                uint32_t rate = F_CPU / cycles;
+                // accept 1% deviation
+                if (frequency >= rate - rate/100 && frequency <= rate + rate/100){
+                    return cycles;
+                }
+            }
+            return 0;
+        }
+
+    protected:
+        /// Samples AVR_BURST_SIZE entries with 4 cycles per sample: in (1) + st (2) + nop (1)
+        static void burstUnrolled(PinBitArray *ptr) {
+            asm volatile(
+                ".rept %[n]\n\t"
+                "in __tmp_reg__, %[port]\n\t"
+                "st X+, __tmp_reg__\n\t"
+                "nop\n\t"
+                ".endr\n\t"
+                : "+x"(ptr)
+                : [port]"I"(_SFR_IO_ADDR(AVR_BURST_PORT)), [n]"n"(AVR_BURST_SIZE)
+                : "memory"
+            );
+        }
+
+        /// Samples count entries with 7 + nops cycles per sample: in (1) + st (2) + sbiw (2) + nops + brne (2)
+        template<uint8_t nops>
+        static void burstLoop(PinBitArray *ptr, uint16_t count) {
+            // sbiw would wrap around to 65535
+            if (count==0) return;
+            asm volatile(
+                "1: in __tmp_reg__, %[port]\n\t"
+                "st X+, __tmp_reg__\n\t"
+                "sbiw %[count], 1\n\t"
+                ".rept %[nops]\n\t"
+                "nop\n\t"
+                ".endr\n\t"
+                "brne 1b\n\t"
+                : "+x"(ptr), [count]"+w"(count)
+                : [port]"I"(_SFR_IO_ADDR(AVR_BURST_PORT)), [nops]"n"(nops)
+                : "memory"
+            );
+        }
+
+        /// Waits w/o interrupts for the trigger with 7 cycles per check. Every 256 checks we verify if a command
+        /// has been received on the serial port: in this case we return false.
+        static bool waitForTriggerBurst(uint8_t mask, uint8_t values) {
+            uint8_t result;
+            uint8_t counter = 0;
+            asm volatile(
+                "1: in __tmp_reg__, %[port]\n\t"
+                "eor __tmp_reg__, %[values]\n\t"
+                "and __tmp_reg__, %[mask]\n\t"
+                "breq 2f\n\t"
+                "dec %[counter]\n\t"
+                "brne 1b\n\t"
+#ifdef UCSR0A
+                "lds __tmp_reg__, %[ucsra]\n\t"
+                "sbrs __tmp_reg__, %[rxc]\n\t"
+#endif
+                "rjmp 1b\n\t"
+                "ldi %[result], 0\n\t"
+                "rjmp 3f\n\t"
+                "2: ldi %[result], 1\n\t"
+                "3:\n\t"
+                : [result]"=d"(result), [counter]"+r"(counter)
+                : [port]"I"(_SFR_IO_ADDR(AVR_BURST_PORT)), [values]"r"(values), [mask]"r"(mask)
+#ifdef UCSR0A
+                , [ucsra]"n"(_SFR_MEM_ADDR(UCSR0A)), [rxc]"I"(RXC0)
+#endif
+            );
+            return result;
+        }
+};
+
+} // namespace
+
+#endif
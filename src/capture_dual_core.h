@@ -0,0 +1,346 @@
+/**
+ * @file capture_dual_core.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Capturing with both cores of the ESP32 or Raspberry Pico which are sampling the same pins phase shifted
+ * by half a period.
+ */
+#pragma once
+
+#include "logic_analyzer.h"
+
+// Max number of periods which the second core can be behind the first core
+#ifndef DUAL_CORE_MAX_SLOT_OFFSET
+#define DUAL_CORE_MAX_SLOT_OFFSET 4
+#endif
+
+namespace logic_analyzer {
+
+/**
+ * @brief Evaluation of interleaved data where the even entries were sampled by the first and the odd entries by
+ * the second core. For a signal which is not synchronized to the sampling, the share of the changes that
+ * fall between a sample of the first core and the following sample of the second core is the phase of the
+ * second core as fraction of the sampling period.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class InterleavedPhase {
+    public:
+        /// Determines the phase (0.0 to 1.0) of the odd entries relative to the even entries: 0.5 is the target. Returns -1 if there are no changes
+        static float phase(const PinBitArray *data, size_t n){
+            size_t leading = 0;
+            size_t total = 0;
+            for (size_t j=1; j<n; j++){
+                int changes = countBits(data[j] ^ data[j-1]);
+                total += changes;
+                // change from even to odd entry
+                if (j & 1){
+                    leading += changes;
+                }
+            }
+            return total==0 ? -1.0 : static_cast<float>(leading) / total;
+        }
+
+        /// Counts the single sample spikes which are the result of samples of the second core that are in the wrong slot
+        static size_t spikes(const PinBitArray *data, size_t n, int slotOffset=0){
+            size_t result = 0;
+            for (size_t j=2; j<n; j++){
+                PinBitArray prev = entry(data, j-2, slotOffset);
+                PinBitArray act = entry(data, j-1, slotOffset);
+                PinBitArray next = entry(data, j, slotOffset);
+                result += countBits((act ^ prev) & ~(next ^ prev));
+            }
+            return result;
+        }
+
+        /// Determines by how many periods the second core is behind the first core
+        static int slotOffset(const PinBitArray *data, size_t n, int maxOffset=DUAL_CORE_MAX_SLOT_OFFSET){
+            int result = 0;
+            size_t min_spikes = spikes(data, n, 0);
+            for (int offset=1; offset<=maxOffset; offset++){
+                size_t count = spikes(data, n, offset);
+                if (count < min_spikes){
+                    min_spikes = count;
+                    result = offset;
+                }
+            }
+            return result;
+        }
+
+    protected:
+        /// Provides the entry at the indicated position when the odd entries are shifted by slotOffset periods
+        static PinBitArray entry(const PinBitArray *data, size_t pos, int slotOffset){
+            // the odd entry was sampled slotOffset periods later than it should have been
+            if (pos & 1 && pos >= 2 * (size_t) slotOffset){
+                return data[pos - 2 * slotOffset];
+            }
+            return data[pos];
+        }
+
+        static int countBits(uint32_t value){
+            return __builtin_popcount(value);
+        }
+};
+
+} // namespace
+
+#if defined(ESP32) || defined(ARDUINO_ARCH_RP2040)
+
+#ifdef ARDUINO_ARCH_RP2040
+#include "pico/multicore.h"
+#endif
+
+// Sampling loop must not be executed from flash
+#if defined(ESP32)
+#define DUAL_CORE_RAM_FUNC IRAM_ATTR
+#else
+#define DUAL_CORE_RAM_FUNC __attribute__((noinline, section(".time_critical.dual_core")))
+#endif
+
+namespace logic_analyzer {
+
+/**
+ * @brief Capturing with both cores: the first core samples into the even and the second core into the odd entries of
+ * the buffer. The second core is started with a delay of half a sampling period so that we get the data in the
+ * right sequence at twice the rate of the single core Capture. The delay needs to be determined with
+ * calibrate() while there is some activity on the captured pins: the capabilities are based on the frequency which 
+ * was measured by the calibration. Requested frequencies below the max frequency of a single core, continuous 
+ * captures and all requests before the calibration are handled by the single core Capture.
+ * The second core can't be used for anything else!
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class DualCoreCapture : public Capture {
+    public:
+        /// Default Constructor: the max frequency is the max frequency of a single core
+        DualCoreCapture(uint64_t maxCaptureFreq, uint64_t maxCaptureFreqThreshold) : Capture(maxCaptureFreq, maxCaptureFreqThreshold) {
+            self() = this;
+        }
+
+        /// starts the capturing of the data: w/o calibration or in demux mode we use the single core Capture
+        virtual void capture() override {
+            log("capture");
+            if (la_state.is_continuous_capture || la_state.is_demux || la_state.frequecy_value < max_frequecy_value || calibrated_frequency == 0){
+                Capture::capture();
+                return;
+            }
+            // no capture if request is well above the calibrated rate
+            if (la_state.frequecy_value > calibrated_frequency + (calibrated_frequency/2)){
+                setStatus(STOPPED);
+                // Send some dummy data to stop pulseview
+                write(0);
+                log("The frequency %u is not supported!", la_state.frequecy_value );
+                return;
+            }
+            if (la_state.trigger_mask && !waitForTrigger()) {
+                log("capture aborted");
+                return;
+            }
+            la_state.setStatus(TRIGGERED);
+            captureAllDualCore();
+            dumpResult();
+        }
+
+        /// With both cores we can capture at the rate which was measured by calibrate()
+        virtual CaptureCapabilities capabilities() override {
+            CaptureCapabilities result = Capture::capabilities();
+            if (calibrated_frequency > max_frequecy_value){
+                result.max_frequency = calibrated_frequency + (calibrated_frequency/2);
+            }
+            return result;
+        }
+
+        /// Captures the requested number of entries with both cores into the buffer
+        void captureAllDualCore() {
+            startSecondCore();
+            // the second core writes up to 2 * DUAL_CORE_MAX_SLOT_OFFSET entries behind the last entry of the first core
+            size_t n = la_state.read_count / 2;
+            size_t max_n = (buffer_ptr->size() - 1 - 2 * DUAL_CORE_MAX_SLOT_OFFSET) / 2;
+            if (n > max_n) n = max_n;
+            log("captureAllDualCore %u entries", (unsigned) (2 * n));
+            buffer_ptr->clear();
+            PinBitArray *data = buffer_ptr->data_ptr();
+
+            // start the second core and sample the even entries
+            core1_ptr = data + 1 + 2 * slot_offset;
+            core1_count = n;
+            core1_done = false;
+            request_flag = true;
+            while(!ready_flag);
+            unsigned long start = micros();
+            start_flag = true;
+            sample(data, n);
+            while(!core1_done);
+            run_time_us = micros() - start;
+            request_flag = false;
+            start_flag = false;
+
+            // entries before the start of the second core
+            for (int j=0; j<slot_offset; j++){
+                data[2*j+1] = data[2*j];
+            }
+            buffer_ptr->setAvailable(2 * n);
+        }
+
+        /// Determines the start delay of the second core from captures of an active signal. Returns the final phase (target 0.5)
+        float calibrate(int maxIterations=20, float tolerance=0.05) {
+            log("calibrate");
+            int read_count = la_state.read_count;
+            la_state.read_count = la_state.max_capture_size;
+            measureDelayLoop();
+            slot_offset = 0;
+            for (int j=0; j<maxIterations; j++){
+                la_state.setStatus(TRIGGERED);
+                captureAllDualCore();
+                size_t n = buffer_ptr->available();
+                int offset = InterleavedPhase::slotOffset(buffer_ptr->data_ptr(), n);
+                if (offset != 0){
+                    slot_offset += offset;
+                    if (slot_offset > DUAL_CORE_MAX_SLOT_OFFSET) slot_offset = DUAL_CORE_MAX_SLOT_OFFSET;
+                    continue;
+                }
+                measured_phase = InterleavedPhase::phase(buffer_ptr->data_ptr(), n);
+                log("phase: %f / delay loops: %d / slot offset: %d", measured_phase, delay_loops, slot_offset);
+                if (measured_phase < 0 || fabs(measured_phase - 0.5) <= tolerance){
+                    break;
+                }
+                // correct the delay proportionally to the error
+                float period_us = run_time_us / (n / 2.0);
+                long correction = (0.5 - measured_phase) * period_us * loops_per_us;
+                if (correction==0) break;
+                long loops = delay_loops + correction;
+                if (loops < 0){
+                    // the second core is already too late: we shift it by one period
+                    slot_offset = slot_offset > 0 ? slot_offset - 1 : 0;
+                    loops += period_us * loops_per_us;
+                }
+                delay_loops = loops < 0 ? 0 : loops;
+            }
+            calibrated_frequency = frequencyMeasured();
+            log("calibrated frequency: %lu", (unsigned long) calibrated_frequency);
+            la_state.read_count = read_count;
+            buffer_ptr->clear();
+            la_state.setStatus(STOPPED);
+            return measured_phase;
+        }
+
+        /// Provides the last measured phase of the second core (target 0.5)
+        float phase() {
+            return measured_phase;
+        }
+
+        /// Provides the calibrated start delay of the second core in loop counts
+        uint32_t delayLoops() {
+            return delay_loops;
+        }
+
+        /// Defines the start delay of the second core and the measured frequency e.g. from a prior calibration: w/o frequency only the single core is used
+        void setDelayLoops(uint32_t loops, int slotOffset=0, uint64_t calibratedFrequency=0){
+            delay_loops = loops;
+            slot_offset = slotOffset;
+            calibrated_frequency = calibratedFrequency;
+        }
+
+        /// Provides the capturing frequency which was measured by calibrate(): 0 if not calibrated
+        uint64_t calibratedFrequency() {
+            return calibrated_frequency;
+        }
+
+        /// Provides the measured capturing frequency of the last dual core capture
+        float frequencyMeasured() {
+            return run_time_us == 0 ? 0 : 1000000.0 * buffer_ptr->available() / run_time_us;
+        }
+
+    protected:
+        /// the instance which is used by the second core: a function local static, so that we do not need C++17
+        static DualCoreCapture *&self() {
+            static DualCoreCapture *instance = nullptr;
+            return instance;
+        }
+        volatile bool request_flag = false;
+        volatile bool ready_flag = false;
+        volatile bool start_flag = false;
+        volatile bool core1_done = false;
+        PinBitArray * volatile core1_ptr = nullptr;
+        volatile size_t core1_count = 0;
+        volatile uint32_t delay_loops = 0;
+        int slot_offset = 0;
+        bool is_core1_started = false;
+        float loops_per_us = 0;
+        float measured_phase = -1;
+        uint64_t calibrated_frequency = 0;
+        unsigned long run_time_us = 0;
+#ifdef ESP32
+        TaskHandle_t task;
+#endif
+
+        /// samples every second entry: identical on both cores, so that both are running at the same speed
+        DUAL_CORE_RAM_FUNC void sample(PinBitArray *ptr, size_t n) {
+            PinReader &reader = *pin_reader_ptr;
+            for (size_t j=0; j<n; j++){
+                *ptr = reader.readAll();
+                ptr += 2;
+            }
+        }
+
+        /// busy wait for the indicated number of loops
+        DUAL_CORE_RAM_FUNC static void spin(uint32_t loops) {
+            for (volatile uint32_t j=0; j<loops; j++);
+        }
+
+        /// Determines the speed of the delay loop
+        void measureDelayLoop() {
+            const uint32_t loops = 100000;
+            unsigned long start = micros();
+            spin(loops);
+            loops_per_us = static_cast<float>(loops) / (micros() - start);
+            log("loops per us: %f", loops_per_us);
+        }
+
+        /// Processing on the second core: wait for the start and sample the odd entries
+        DUAL_CORE_RAM_FUNC void processSecondCore() {
+            ready_flag = true;
+            while(!start_flag);
+            spin(delay_loops);
+            sample(core1_ptr, core1_count);
+            ready_flag = false;
+            core1_done = true;
+            while(start_flag);
+        }
+
+        /// launches the endless processing loop on the second core
+        void startSecondCore() {
+            if (is_core1_started) return;
+            is_core1_started = true;
+#ifdef ESP32
+            xTaskCreatePinnedToCore(secondCoreTask, "DualCoreCapture", 4096, nullptr, configMAX_PRIORITIES - 1, &task, xPortGetCoreID() == 0 ? 1 : 0);
+#else
+            multicore_launch_core1(secondCoreLoop);
+#endif
+        }
+
+#ifdef ESP32
+        static void secondCoreTask(void*) {
+            while(true){
+                // give the idle task a chance while we are not capturing
+                if (!self()->request_flag) {
+                    vTaskDelay(1);
+                    continue;
+                }
+                self()->processSecondCore();
+            }
+        }
+#else
+        static void secondCoreLoop() {
+            while(true){
+                if (self()->request_flag) {
+                    self()->processSecondCore();
+                }
+            }
+        }
+#endif
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,261 @@
+/**
+ * @file capture_dual_timebase.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Capturing at max speed around the trigger and at the requested frequency elsewhere
+ */
+#pragma once
+
+#include "logic_analyzer.h"
+
+namespace logic_analyzer {
+
+/// Max number of segments: coarse pre-trigger, fine pre-trigger, fine post-trigger and coarse post-trigger
+#define DUAL_TIMEBASE_MAX_SEGMENTS 4
+
+/**
+ * @brief Segment of the captured data with a constant sampling rate. The frequency is measured during the capture 
+ * and the offset is the time in nanoseconds from the last entry of the prior segment to the first entry of this one.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct TimebaseSegment {
+    uint32_t count;
+    uint32_t frequency;
+    uint32_t offset;
+};
+
+/**
+ * @brief Dual timebase capturing: the fine window around the trigger is sampled at max speed and the remaining
+ * pre- and post-trigger history at the requested frequency. We always sample at max speed and only keep every nth 
+ * sample for the coarse parts: the pre-trigger samples are collected in a small ring of the size of the fine window 
+ * and the samples which are dropped from it are decimated into the RingBuffer. The sampling loops are running at 
+ * different speeds, so we measure the duration of each of them with micros() and report the resulting rate of each 
+ * segment with the vendor command SUMP_VENDOR_GET_SEGMENTS, so that the host can rebuild the real timeline. Empty 
+ * segments are not reported.
+ * Continuous and demux requests or a request w/o fine window are handled by the Capture.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class DualTimebaseCapture : public Capture {
+    public:
+        /// Default Constructor
+        DualTimebaseCapture(uint64_t maxCaptureFreq, uint64_t maxCaptureFreqThreshold) : Capture(maxCaptureFreq, maxCaptureFreqThreshold) {
+        }
+
+        /// Destructor
+        ~DualTimebaseCapture() {
+            if (fine_data!=nullptr){
+                delete[] fine_data;
+            }
+        }
+
+        /// Defines the number of samples at max speed before and after the trigger
+        void setFineWindow(size_t pre, size_t post) {
+            if (fine_data!=nullptr){
+                delete[] fine_data;
+                fine_data = nullptr;
+            }
+            fine_pre = 0;
+            fine_post = 0;
+            // the post-trigger samples are stored behind the fine ring
+            if (pre + post > 0){
+                fine_data = new PinBitArray[pre + post];
+                if (fine_data!=nullptr){
+                    fine_pre = pre;
+                    fine_post = post;
+                }
+            }
+        }
+
+        /// starts the capturing of the data
+        virtual void capture() override {
+            if (la_state.is_continuous_capture || la_state.is_demux || fine_pre + fine_post == 0){
+                segment_count = 0;
+                Capture::capture();
+                return;
+            }
+            if (!isSupportedFrequency()){
+                return;
+            }
+            log("capture dual timebase");
+            uint64_t frequency = la_state.frequecy_value;
+            // the nearest integer ratio: the effective rate is reported with the segments
+            uint32_t ratio = frequency == 0 || frequency >= max_frequecy_value ? 1 : (max_frequecy_value + frequency / 2) / frequency;
+            long keep = la_state.read_count - la_state.delay_count;
+            if (keep < 0) keep = 0;
+            size_t raw_count = 0;
+            size_t last_coarse = 0;
+            float wait_period = 0;
+
+            TRACE_BEGIN("capture");
+            buffer_ptr->clear();
+            if (la_state.trigger_mask){
+                unsigned long start_us = micros();
+                if (!waitForTriggerDual(ratio, raw_count, last_coarse)){
+                    log("capture aborted");
+                    TRACE_END("capture");
+                    return;
+                }
+                wait_period = periodNs(micros() - start_us, raw_count);
+            }
+            la_state.setStatus(TRIGGERED);
+
+            // fine post-trigger: measured separately because this loop is faster
+            size_t fine_post_count = fine_post < (size_t) la_state.delay_count ? fine_post : la_state.delay_count;
+            PinBitArray *post_data = fine_data + fine_pre;
+            PinReader &reader = *pin_reader_ptr;
+            unsigned long start_us = micros();
+            for (size_t j=0; j<fine_post_count; j++){
+                post_data[j] = reader.readAll();
+            }
+            unsigned long post_end_us = micros();
+            float post_period = periodNs(post_end_us - start_us, fine_post_count);
+
+            // coarse pre-trigger history followed by the fine window: the newest coarse entries are kept
+            size_t fine_pre_count = raw_count < fine_pre ? raw_count : fine_pre;
+            size_t fine_pre_keep = fine_pre_count < (size_t) keep ? fine_pre_count : keep;
+            size_t coarse_pre = keep - fine_pre_keep;
+            if (buffer_ptr->available() > coarse_pre){
+                buffer_ptr->clear(buffer_ptr->available() - coarse_pre);
+            }
+            size_t coarse_pre_count = buffer_ptr->available();
+            size_t start = (fine_pos + fine_pre - fine_pre_keep) % (fine_pre > 0 ? fine_pre : 1);
+            for (size_t j=0; j<fine_pre_keep; j++){
+                buffer_ptr->write(fine_data[(start + j) % fine_pre]);
+            }
+            for (size_t j=0; j<fine_post_count; j++){
+                buffer_ptr->write(post_data[j]);
+            }
+
+            // coarse post-trigger 
+            size_t coarse_post = la_state.delay_count - fine_post_count;
+            size_t raw_post = 0;
+            start_us = micros();
+            size_t stored = captureDecimated(ratio, coarse_post, raw_post);
+            float coarse_post_period = periodNs(micros() - start_us, raw_post);
+            // copying the fine window delays the start of the coarse post-trigger loop
+            float copy_ns = 1000.0f * (start_us - post_end_us);
+
+            // the times are relative to the trigger sample which is the last raw sample of the wait loop
+            segment_count = 0;
+            float coarse_pre_last = -wait_period * (raw_count - 1 - last_coarse);
+            addSegment(coarse_pre_count, wait_period * ratio, coarse_pre_last - wait_period * ratio * (coarse_pre_count - 1.0f));
+            addSegment(fine_pre_keep, wait_period, -wait_period * (fine_pre_keep - 1.0f));
+            addSegment(fine_post_count, post_period, post_period);
+            addSegment(stored, coarse_post_period * ratio, post_period * fine_post_count + copy_ns + coarse_post_period * ratio);
+            TRACE_END("capture");
+            dumpResult();
+            phase = IDLE;
+        }
+
+        /// Provides the number of segments of the last capture
+        int segmentCount() {
+            return segment_count;
+        }
+
+        /// Provides the indicated segment of the last capture
+        TimebaseSegment &segment(int idx) {
+            return segments[idx];
+        }
+
+        /// Handles SUMP_VENDOR_GET_SEGMENTS: number of segments followed by the segments as big endian uint32_t
+        virtual bool processCommand(int cmd) override {
+            if (cmd != SUMP_VENDOR_GET_SEGMENTS) return false;
+            log("=>SUMP_VENDOR_GET_SEGMENTS");
+            uint32_t header = htonl((uint32_t) segment_count);
+            stream().write((const uint8_t*)&header, sizeof(header));
+            for (int j=0; j<segment_count; j++){
+                uint32_t values[3] = {htonl(segments[j].count), htonl(segments[j].frequency), htonl(segments[j].offset)};
+                stream().write((const uint8_t*)values, sizeof(values));
+            }
+            stream().flush();
+            return true;
+        }
+
+    protected:
+        PinBitArray *fine_data = nullptr;
+        size_t fine_pre = 0;
+        size_t fine_post = 0;
+        size_t fine_pos = 0;
+        TimebaseSegment segments[DUAL_TIMEBASE_MAX_SEGMENTS];
+        int segment_count = 0;
+        float last_entry_ns = 0;
+
+        /// Measured sampling period in ns: if the loop was too short for micros() we use the max frequency
+        float periodNs(unsigned long timeUs, size_t samples) {
+            if (timeUs == 0 || samples == 0) return 1000000000.0f / max_frequecy_value;
+            return 1000.0f * timeUs / samples;
+        }
+
+        /// Adds a non empty segment: the time of its first entry is relative to the trigger in ns
+        void addSegment(size_t count, float period, float firstEntryNs) {
+            if (count == 0) return;
+            float offset = segment_count == 0 ? 0 : firstEntryNs - last_entry_ns;
+            if (offset < 0) offset = 0;
+            segments[segment_count++] = {(uint32_t) count, (uint32_t) (1000000000.0f / period + 0.5f), offset > 4294967295.0f ? 0xFFFFFFFFUL : (uint32_t) (offset + 0.5f)};
+            last_entry_ns = firstEntryNs + period * (count - 1);
+        }
+
+        /// Waits at max speed for the trigger: the last fine_pre samples are kept in the fine ring and every nth sample 
+        /// that is dropped from it is stored in the buffer. Provides the number of raw samples (incl. the trigger) and 
+        /// the raw index of the last stored coarse entry. Returns false if the capture has been aborted
+        bool waitForTriggerDual(uint32_t ratio, size_t &rawCount, size_t &lastCoarse) {
+            PinReader &reader = *pin_reader_ptr;
+            PinBitArray mask = la_state.trigger_mask;
+            PinBitArray values = la_state.trigger_values;
+            size_t count = 0;
+            uint32_t step = 0;
+            fine_pos = 0;
+            while(true){
+                for (int j=0; j<ABORT_CHECK_INTERVAL; j++){
+                    PinBitArray value = reader.readAll();
+                    count++;
+                    if (fine_pre > 0){
+                        PinBitArray dropped = fine_data[fine_pos];
+                        fine_data[fine_pos] = value;
+                        if (++fine_pos == fine_pre) fine_pos = 0;
+                        if (count > fine_pre && ++step >= ratio){
+                            step = 0;
+                            buffer_ptr->write(dropped);
+                            lastCoarse = count - 1 - fine_pre;
+                        }
+                    } else if (++step >= ratio){
+                        step = 0;
+                        buffer_ptr->write(value);
+                        lastCoarse = count - 1;
+                    }
+                    if (((values ^ value) & mask)==0){
+                        rawCount = count;
+                        return true;
+                    }
+                }
+                if (la_state.status_value == STOPPED || isAbortRequested()){
+                    return false;
+                }
+            }
+        }
+
+        /// Samples at max speed and stores every nth sample until count entries are available: returns the number of stored 
+        /// entries and provides the number of raw samples
+        size_t captureDecimated(uint32_t ratio, size_t count, size_t &rawCount) {
+            PinReader &reader = *pin_reader_ptr;
+            size_t stored = 0;
+            uint32_t step = 0;
+            while(stored < count){
+                for (int j=0; j<ABORT_CHECK_INTERVAL && stored < count; j++){
+                    PinBitArray value = reader.readAll();
+                    rawCount++;
+                    if (++step >= ratio){
+                        step = 0;
+                        buffer_ptr->write(value);
+                        stored++;
+                    }
+                }
+                if (isAbortRequested()) break;
+            }
+            return stored;
+        }
+};
+
+} // namespace
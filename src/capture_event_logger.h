@@ -0,0 +1,161 @@
+/**
+ * @file capture_event_logger.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Logging of the trigger events w/o storing the samples
+ */
+#pragma once
+
+#include "logic_analyzer.h"
+
+// Max number of event records which are kept until they are sent
+#ifndef EVENT_LOGGER_SIZE
+#define EVENT_LOGGER_SIZE 64
+#endif
+
+// Number of records which are sent together
+#ifndef EVENT_LOGGER_BATCH
+#define EVENT_LOGGER_BATCH 16
+#endif
+
+// Max time in us before pending records are sent
+#ifndef EVENT_LOGGER_FLUSH_US
+#define EVENT_LOGGER_FLUSH_US 100000
+#endif
+
+// Magic number at the start of each batch: "LAEV"
+#ifndef EVENT_LOGGER_MAGIC
+#define EVENT_LOGGER_MAGIC 0x4C414556UL
+#endif
+
+namespace logic_analyzer {
+
+/**
+ * @brief Evaluates the trigger continuously at the speed of the trigger loop and only records the time (and optionally 
+ * the pins) when the trigger condition starts to match: a condition which stays active is only logged once. Without
+ * trigger mask all channels are relevant and we log each change of the pins. The records are kept in a small ring and are sent in batches: each batch starts with the magic number 0x4C414556 
+ * ("LAEV"), the number of records and the number of records that were dropped because the ring was full. Each record 
+ * consists of the time in microseconds as 64 bit value (high and low part) followed by the pins if snapshots 
+ * are active. All numbers (incl. the pins) are big endian uint32_t. The logging runs until it is stopped with any command (e.g. a RESET).
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class EventLoggerCapture : public Capture {
+    public:
+        /// Default Constructor
+        EventLoggerCapture(uint64_t maxCaptureFreq, uint64_t maxCaptureFreqThreshold) : Capture(maxCaptureFreq, maxCaptureFreqThreshold) {
+        }
+
+        /// Activates the recording of the pins with each event
+        void setSnapshot(bool active) {
+            is_snapshot = active;
+        }
+
+        /// Provides the number of events which were lost in the last logging because the ring was full
+        size_t dropped() {
+            return dropped_count;
+        }
+
+        /// Provides the number of logged events of the last logging
+        size_t events() {
+            return event_count;
+        }
+
+        /// logs the trigger events until the processing is stopped
+        virtual void capture() override {
+            log("capture event logger");
+            PinReader &reader = *pin_reader_ptr;
+            PinBitArray mask = la_state.trigger_mask;
+            PinBitArray values = la_state.trigger_values;
+            bool was_matching = true;
+            bool is_change_log = mask == 0;
+            PinBitArray last_value = reader.readAll();
+            read_pos = write_pos = count = 0;
+            dropped_count = event_count = batch_dropped = 0;
+            high_us = 0;
+            last_us = last_flush_us = micros();
+
+            TRACE_BEGIN("event logger");
+            while(true){
+                for (int j=0; j<ABORT_CHECK_INTERVAL; j++){
+                    PinBitArray value = reader.readAll();
+                    if (is_change_log){
+                        if (value != last_value){
+                            record(value);
+                            last_value = value;
+                        }
+                        continue;
+                    }
+                    bool is_matching = ((values ^ value) & mask)==0;
+                    if (is_matching && !was_matching){
+                        record(value);
+                    }
+                    was_matching = is_matching;
+                }
+                uint64_t now = timeUs();
+                if (count >= EVENT_LOGGER_BATCH || (count > 0 && now - last_flush_us >= EVENT_LOGGER_FLUSH_US)){
+                    sendBatch();
+                    last_flush_us = now;
+                }
+                if (la_state.status_value == STOPPED || isAbortRequested()){
+                    break;
+                }
+            }
+            if (count > 0) sendBatch();
+            TRACE_END("event logger");
+            log("event logger ended with %lu events", (unsigned long) event_count);
+            setStatus(STOPPED);
+        }
+
+    protected:
+        /// Recorded event
+        struct EventRecord {
+            uint64_t time_us;
+            PinBitArray pins;
+        };
+        EventRecord records[EVENT_LOGGER_SIZE];
+        size_t read_pos = 0;
+        size_t write_pos = 0;
+        size_t count = 0;
+        size_t dropped_count = 0;
+        size_t batch_dropped = 0;
+        size_t event_count = 0;
+        bool is_snapshot = false;
+        uint64_t last_flush_us = 0;
+
+        /// adds an event to the ring
+        inline void record(PinBitArray pins) {
+            event_count++;
+            if (count >= EVENT_LOGGER_SIZE){
+                dropped_count++;
+                batch_dropped++;
+                return;
+            }
+            EventRecord &rec = records[write_pos];
+            rec.time_us = timeUs();
+            rec.pins = pins;
+            if (++write_pos == EVENT_LOGGER_SIZE) write_pos = 0;
+            count++;
+        }
+
+        /// sends all pending records
+        void sendBatch() {
+            uint32_t header[3] = {htonl(EVENT_LOGGER_MAGIC), htonl((uint32_t) count), htonl((uint32_t) batch_dropped)};
+            stream_ptr->write((const uint8_t*)header, sizeof(header));
+            while (count > 0){
+                EventRecord &rec = records[read_pos];
+                uint32_t time[2] = {htonl((uint32_t)(rec.time_us >> 32)), htonl((uint32_t) rec.time_us)};
+                stream_ptr->write((const uint8_t*)time, sizeof(time));
+                if (is_snapshot){
+                    uint32_t pins = htonl((uint32_t) rec.pins);
+                    stream_ptr->write((const uint8_t*)&pins, sizeof(pins));
+                }
+                if (++read_pos == EVENT_LOGGER_SIZE) read_pos = 0;
+                count--;
+            }
+            stream_ptr->flush();
+            batch_dropped = 0;
+        }
+};
+
+} // namespace
@@ -0,0 +1,185 @@
+/**
+ * @file capture_histogram.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Histogram of the bus states w/o storing the samples
+ */
+#pragma once
+
+#include "logic_analyzer.h"
+
+// On AVR we use smaller counters, so that the table fits into the SRAM (512 instead of 1024 bytes)
+#ifdef AVR
+#ifndef HISTOGRAM_COUNTER_TYPE
+#define HISTOGRAM_COUNTER_TYPE uint16_t
+#endif
+#endif
+
+// Number of bits of the histogram index: the table has 2^HISTOGRAM_BITS bins
+#ifndef HISTOGRAM_BITS
+#define HISTOGRAM_BITS 8
+#endif
+
+// Data type of the counters
+#ifndef HISTOGRAM_COUNTER_TYPE
+#define HISTOGRAM_COUNTER_TYPE uint32_t
+#endif
+
+namespace logic_analyzer {
+
+/**
+ * @brief Counts at max speed how often each bus state occurs: the counter table is indexed by the sampled pins. 
+ * For more channels than HISTOGRAM_BITS the pins are hashed with setHashed(true) or the index is restricted with 
+ * setMask() to up to HISTOGRAM_BITS arbitrary pins, which are compacted into the index. The counters saturate 
+ * instead of overflowing.
+ * The counting runs until it is stopped with any other command (e.g. a RESET) and the table can be requested at any 
+ * time with the vendor command SUMP_VENDOR_GET_HISTOGRAM: we answer with the number of bits, the total number 
+ * of samples (high and low part) and the counters of all bins as big endian uint32_t.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class HistogramCapture : public Capture {
+    public:
+        /// Default Constructor
+        HistogramCapture(uint64_t maxCaptureFreq, uint64_t maxCaptureFreqThreshold) : Capture(maxCaptureFreq, maxCaptureFreqThreshold) {
+        }
+
+        /// Defines the pins which are used as index: the selected pins are compacted into the index in their order. 
+        /// A mask with more than HISTOGRAM_BITS pins is rejected and the prior mask is kept
+        bool setMask(PinBitArray mask) {
+            IndexRun runs[HISTOGRAM_BITS];
+            int count = 0;
+            int target = 0;
+            int last_bit = -2;
+            for (int bit=0; bit<(int)(sizeof(PinBitArray)*8); bit++){
+                if (!(mask & ((PinBitArray)1 << bit))) continue;
+                if (target >= HISTOGRAM_BITS){
+                    log("histogram mask 0x%lx exceeds %d bits", (unsigned long) mask, HISTOGRAM_BITS);
+                    return false;
+                }
+                // adjacent pins are kept in the same run
+                if (bit != last_bit + 1){
+                    runs[count].shift = bit - target;
+                    runs[count].mask = 0;
+                    count++;
+                }
+                runs[count-1].mask |= (size_t)1 << target;
+                last_bit = bit;
+                target++;
+            }
+            memcpy(index_runs, runs, sizeof(runs));
+            run_count = count;
+            return true;
+        }
+
+        /// Use a multiplicative hash of all pins as index
+        void setHashed(bool hashed) {
+            is_hashed = hashed;
+        }
+
+        /// Removes all counts
+        void clear() {
+            memset(table, 0, sizeof(table));
+            total = 0;
+        }
+
+        /// Provides the counter of the indicated bin
+        HISTOGRAM_COUNTER_TYPE count(size_t bin) {
+            return table[bin];
+        }
+
+        /// Provides the number of counted samples
+        uint64_t samples() {
+            return total;
+        }
+
+        /// counts the samples until the processing is stopped
+        virtual void capture() override {
+            log("capture histogram");
+            PinReader &reader = *pin_reader_ptr;
+            clear();
+            TRACE_BEGIN("histogram");
+            while(true){
+                if (is_hashed){
+                    for (int j=0; j<ABORT_CHECK_INTERVAL; j++){
+                        increment(table[hash(reader.readAll())]);
+                    }
+                } else if (run_count <= 1){
+                    // adjacent pins: a single shift and mask
+                    uint8_t shift = index_runs[0].shift;
+                    size_t mask = run_count == 0 ? 0 : index_runs[0].mask;
+                    for (int j=0; j<ABORT_CHECK_INTERVAL; j++){
+                        increment(table[((size_t)reader.readAll() >> shift) & mask]);
+                    }
+                } else {
+                    for (int j=0; j<ABORT_CHECK_INTERVAL; j++){
+                        increment(table[index(reader.readAll())]);
+                    }
+                }
+                total += ABORT_CHECK_INTERVAL;
+                // the table can be requested while we are counting
+                if (stream_ptr->available()>0 && stream_ptr->peek()==SUMP_VENDOR_GET_HISTOGRAM){
+                    stream_ptr->read();
+                    sendTable();
+                }
+                if (la_state.status_value == STOPPED || isAbortRequested()){
+                    break;
+                }
+            }
+            TRACE_END("histogram");
+            setStatus(STOPPED);
+        }
+
+        /// Provides the table when we are not counting
+        virtual bool processCommand(int cmd) override {
+            if (cmd != SUMP_VENDOR_GET_HISTOGRAM) return false;
+            log("=>SUMP_VENDOR_GET_HISTOGRAM");
+            sendTable();
+            return true;
+        }
+
+    protected:
+        static const size_t bins = 1UL << HISTOGRAM_BITS;
+        HISTOGRAM_COUNTER_TYPE table[bins];
+        uint64_t total = 0;
+        /// adjacent pins of the mask: the pins are shifted by shift and masked to their bits in the index
+        struct IndexRun {
+            uint8_t shift;
+            size_t mask;
+        };
+        IndexRun index_runs[HISTOGRAM_BITS] = {{0, bins - 1}};
+        int run_count = 1;
+        bool is_hashed = false;
+
+        /// compacts the pins of the mask into the index
+        inline size_t index(PinBitArray value) {
+            size_t result = 0;
+            for (int j=0; j<run_count; j++){
+                result |= ((size_t)value >> index_runs[j].shift) & index_runs[j].mask;
+            }
+            return result;
+        }
+
+        /// counters saturate instead of overflowing
+        static inline void increment(HISTOGRAM_COUNTER_TYPE &counter) {
+            if (counter != (HISTOGRAM_COUNTER_TYPE) ~0) counter++;
+        }
+
+        /// Fibonacci hashing of the pins to HISTOGRAM_BITS
+        static inline size_t hash(PinBitArray value) {
+            return (static_cast<uint32_t>(value) * 2654435769UL) >> (32 - HISTOGRAM_BITS);
+        }
+
+        /// sends the number of bits, the total and the counters
+        void sendTable() {
+            uint32_t header[3] = {htonl(HISTOGRAM_BITS), htonl((uint32_t)(total >> 32)), htonl((uint32_t) total)};
+            stream_ptr->write((const uint8_t*)header, sizeof(header));
+            for (size_t j=0; j<bins; j++){
+                uint32_t value = htonl((uint32_t) table[j]);
+                stream_ptr->write((const uint8_t*)&value, sizeof(value));
+            }
+            stream_ptr->flush();
+        }
+};
+
+} // namespace
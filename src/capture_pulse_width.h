@@ -0,0 +1,247 @@
+/**
+ * @file capture_pulse_width.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Histograms of the pulse widths and periods per channel w/o storing the samples
+ */
+#pragma once
+
+#include "logic_analyzer.h"
+
+// The 3 histograms of all channels need channels * 3 * PULSE_HISTOGRAM_BINS counters: on AVR we use less and 
+// smaller counters, so that they fit into the SRAM (768 instead of 2304 bytes)
+#ifdef AVR
+#ifndef PULSE_HISTOGRAM_BINS
+#define PULSE_HISTOGRAM_BINS 16
+#endif
+#ifndef PULSE_HISTOGRAM_COUNTER_TYPE
+#define PULSE_HISTOGRAM_COUNTER_TYPE uint16_t
+#endif
+#endif
+
+// Number of log2 bins per histogram: longer runs are counted in the last bin
+#ifndef PULSE_HISTOGRAM_BINS
+#define PULSE_HISTOGRAM_BINS 24
+#endif
+
+// Data type of the counters
+#ifndef PULSE_HISTOGRAM_COUNTER_TYPE
+#define PULSE_HISTOGRAM_COUNTER_TYPE uint32_t
+#endif
+
+// Interval in us in which the histograms are sent
+#ifndef PULSE_SNAPSHOT_US
+#define PULSE_SNAPSHOT_US 1000000
+#endif
+
+// Magic number at the start of each snapshot: "LAPW"
+#ifndef PULSE_SNAPSHOT_MAGIC
+#define PULSE_SNAPSHOT_MAGIC 0x4C415057UL
+#endif
+
+namespace logic_analyzer {
+
+/**
+ * @brief Determines the distribution of the high times, low times and periods (from rising edge to rising edge) 
+ * of each channel at max speed w/o storing any samples: we keep the position of the last edge per channel and 
+ * count each completed run in a log2 scaled histogram, where bin n is counting the runs with 2^n to 2^(n+1)-1 
+ * samples. A sample w/o change costs only one comparison, a change is processed for each changed channel. 
+ * Every PULSE_SNAPSHOT_US and at the end we send a snapshot which starts with the magic number 0x4C415057 
+ * ("LAPW"), the number of channels, the number of bins, the number of samples and the elapsed time in us (both as 
+ * high and low part) followed by the high, low and period histograms of each channel (all big endian uint32_t). 
+ * The positions are kept as 32 bit values: runs which span a full overflow of the sample counter are counted in the 
+ * last bin. The processing runs until it is 
+ * stopped with any command (e.g. a RESET).
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class PulseWidthCapture : public AbstractCapture {
+    public:
+        /// Default Constructor
+        PulseWidthCapture() : AbstractCapture() {
+        }
+
+        /// Provides the histogram of the high times of the indicated channel
+        PULSE_HISTOGRAM_COUNTER_TYPE *highTimes(int channel) {
+            return high_hist[channel];
+        }
+
+        /// Provides the histogram of the low times of the indicated channel
+        PULSE_HISTOGRAM_COUNTER_TYPE *lowTimes(int channel) {
+            return low_hist[channel];
+        }
+
+        /// Provides the histogram of the periods of the indicated channel
+        PULSE_HISTOGRAM_COUNTER_TYPE *periods(int channel) {
+            return period_hist[channel];
+        }
+
+        /// Provides the number of evaluated samples
+        uint64_t samples() {
+            return (static_cast<uint64_t>(sample_high) << 32) | sample_count;
+        }
+
+        /// Provides the elapsed time in us since the start
+        uint64_t elapsedUs() {
+            unsigned long now = micros();
+            elapsed_us += now - last_us;
+            last_us = now;
+            return elapsed_us;
+        }
+
+        /// collects the histograms and sends them periodically until the processing is stopped
+        virtual void capture() override {
+            log("capture pulse width");
+            TRACE_BEGIN("pulse width");
+            begin();
+            uint64_t last_snapshot_us = 0;
+            while(true){
+                process(ABORT_CHECK_INTERVAL);
+                // this also extends micros() to 64 bits
+                uint64_t now = elapsedUs();
+                if (now - last_snapshot_us >= PULSE_SNAPSHOT_US){
+                    last_snapshot_us = now;
+                    sendSnapshot();
+                }
+                if (la_state.status_value == STOPPED || isAbortRequested()){
+                    break;
+                }
+            }
+            sendSnapshot();
+            TRACE_END("pulse width");
+            setStatus(STOPPED);
+        }
+
+        /// Used to measure the speed: collects the histograms for the read count samples
+        virtual void captureAll() override {
+            begin();
+            process(la_state.read_count);
+        }
+
+    protected:
+        static const int channels = sizeof(PinBitArray) * 8;
+        PULSE_HISTOGRAM_COUNTER_TYPE high_hist[channels][PULSE_HISTOGRAM_BINS];
+        PULSE_HISTOGRAM_COUNTER_TYPE low_hist[channels][PULSE_HISTOGRAM_BINS];
+        PULSE_HISTOGRAM_COUNTER_TYPE period_hist[channels][PULSE_HISTOGRAM_BINS];
+        uint32_t last_edge[channels];
+        uint32_t last_rise[channels];
+        PinBitArray has_edge = 0;
+        PinBitArray has_rise = 0;
+        // channels with an edge since the last overflow of the sample counter
+        PinBitArray epoch_edge = 0;
+        PinBitArray epoch_rise = 0;
+        // channels with a pending run which is longer than the range of the sample counter
+        PinBitArray long_edge = 0;
+        PinBitArray long_rise = 0;
+        PinBitArray last = 0;
+        uint32_t sample_count = 0;
+        uint32_t sample_high = 0;
+        uint64_t elapsed_us = 0;
+        unsigned long last_us = 0;
+
+        /// resets the histograms and starts with the actual sample
+        void begin() {
+            memset(high_hist, 0, sizeof(high_hist));
+            memset(low_hist, 0, sizeof(low_hist));
+            memset(period_hist, 0, sizeof(period_hist));
+            has_edge = has_rise = 0;
+            epoch_edge = epoch_rise = long_edge = long_rise = 0;
+            last = pin_reader_ptr->readAll();
+            sample_count = 1;
+            sample_high = 0;
+            elapsed_us = 0;
+            last_us = micros();
+        }
+
+        /// evaluates the next n samples
+        void process(size_t n) {
+            PinReader &reader = *pin_reader_ptr;
+            uint32_t start = sample_count;
+            for (size_t j=0; j<n; j++){
+                PinBitArray value = reader.readAll();
+                PinBitArray changes = value ^ last;
+                if (changes){
+                    processChanges(changes, value);
+                    last = value;
+                }
+                sample_count++;
+            }
+            if (sample_count < start){
+                nextEpoch();
+            }
+        }
+
+        /// The sample counter has overflown: pending runs w/o edge in the last epoch are longer than 2^32 samples
+        void nextEpoch() {
+            sample_high++;
+            long_edge |= has_edge & ~epoch_edge;
+            long_rise |= has_rise & ~epoch_rise;
+            epoch_edge = epoch_rise = 0;
+        }
+
+        /// counts the completed runs of the changed channels
+        void processChanges(PinBitArray changes, PinBitArray value) {
+            while (changes){
+                int channel = __builtin_ctzll((unsigned long long) changes);
+                PinBitArray bit = (PinBitArray)1 << channel;
+                changes &= changes - 1;
+                // the first run is incomplete
+                if (has_edge & bit){
+                    int idx = long_edge & bit ? PULSE_HISTOGRAM_BINS - 1 : bin(sample_count - last_edge[channel]);
+                    if (last & bit){
+                        increment(high_hist[channel][idx]);
+                    } else {
+                        increment(low_hist[channel][idx]);
+                    }
+                }
+                if (value & bit){
+                    if (has_rise & bit){
+                        increment(period_hist[channel][long_rise & bit ? PULSE_HISTOGRAM_BINS - 1 : bin(sample_count - last_rise[channel])]);
+                    }
+                    last_rise[channel] = sample_count;
+                    has_rise |= bit;
+                    epoch_rise |= bit;
+                    long_rise &= ~bit;
+                }
+                last_edge[channel] = sample_count;
+                has_edge |= bit;
+                epoch_edge |= bit;
+                long_edge &= ~bit;
+            }
+        }
+
+        /// counters saturate instead of overflowing
+        static inline void increment(PULSE_HISTOGRAM_COUNTER_TYPE &counter) {
+            if (counter != (PULSE_HISTOGRAM_COUNTER_TYPE) ~0) counter++;
+        }
+
+        /// log2 bin of the length
+        static inline int bin(uint32_t len) {
+            int result = len==0 ? 0 : 31 - __builtin_clz(len);
+            return result < PULSE_HISTOGRAM_BINS ? result : PULSE_HISTOGRAM_BINS - 1;
+        }
+
+        /// sends the header and the histograms of all channels
+        void sendSnapshot() {
+            uint64_t samples_total = samples();
+            uint64_t time_us = elapsedUs();
+            uint32_t header[7] = {htonl(PULSE_SNAPSHOT_MAGIC), htonl(channels), htonl(PULSE_HISTOGRAM_BINS), htonl((uint32_t)(samples_total >> 32)), 
+                htonl((uint32_t) samples_total), htonl((uint32_t)(time_us >> 32)), htonl((uint32_t) time_us)};
+            stream_ptr->write((const uint8_t*)header, sizeof(header));
+            for (int c=0; c<channels; c++){
+                sendBins(high_hist[c]);
+                sendBins(low_hist[c]);
+                sendBins(period_hist[c]);
+            }
+            stream_ptr->flush();
+        }
+
+        void sendBins(PULSE_HISTOGRAM_COUNTER_TYPE *bins) {
+            for (int j=0; j<PULSE_HISTOGRAM_BINS; j++){
+                uint32_t value = htonl((uint32_t) bins[j]);
+                stream_ptr->write((const uint8_t*)&value, sizeof(value));
+            }
+        }
+};
+
+} // namespace
@@ -6,10 +6,17 @@
 
 #include "hardware/pio.h"
 #include "hardware/dma.h"
+#include "hardware/clocks.h"
 #include "hardware/structs/bus_ctrl.h"
 
 // Some logic to analyse:
 #include "logic_analyzer.h"
+#include "block_scanner.h"
+
+// Size of the DMA ring buffer of the PicoCapturePIORing in bytes as power of 2: it is allocated at the first capture
+#ifndef PICO_RING_BITS
+#define PICO_RING_BITS 15
+#endif
 
 namespace logic_analyzer {
 
@@ -67,9 +74,10 @@ class PicoCapturePIO : public AbstractCapture {
             return measured_freq;
         }
 
+        /// Provides the max frequency: it is measured with a capture at the first call and cached
         float maxFrequency(int warmup=1, int repeat=2) {
-            log("determine maxFrequency");
-            if (max_frequecy_value<=0.0) {
+            if (!isCalibrated()) {
+                log("determine maxFrequency");
                 pin_base = logicAnalyzer().startPin();
                 pin_count = logicAnalyzer().numberOfPins();
                 n_samples = logicAnalyzer().readCount();
@@ -91,14 +99,46 @@ class PicoCapturePIO : public AbstractCapture {
                 }
                 max_frequecy_value = freqTotal / repeat;
                 log("maxFrequency: %f", max_frequecy_value);
+                // the plan was based on the nominal frequency
+                capture_plan.is_valid = false;
             }
             return max_frequecy_value;
         }
 
+        /// Checks if the max frequency has already been measured
+        bool isCalibrated() {
+            return max_frequecy_value > 0.0;
+        }
+
         float divider() {
             return divider_value;
         }
 
+        /// The PIO is sampling with exact timing but there is no trigger support yet
+        virtual CaptureCapabilities capabilities() override {
+            CaptureCapabilities result;
+            result.max_frequency = 1.5 * planningFrequency();
+            result.is_exact_timing = true;
+            return result;
+        }
+
+        /// The PIO divider is determined when the frequency is changing: this does not access the hardware
+        virtual void updatePlan(Event event) override {
+            switch(event){
+                case CAPTURE_FREQUNCY:
+                case PROFILE: {
+                        uint64_t frequency = logicAnalyzer().captureFrequency();
+                        // if we are well above the limit we do not capture at all
+                        capture_plan.loop = frequency > (1.5 * planningFrequency()) ? LOOP_UNSUPPORTED : LOOP_MAX_SPEED;
+                        capture_plan.clock_divider = calculateDivider(frequency);
+                        capture_plan.is_valid = true;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
 
     protected:
         PIO pio = pio0;
@@ -121,11 +161,45 @@ class PicoCapturePIO : public AbstractCapture {
         float test_duty_cycle;
         int test_pin=-1;
 
+        /// Loaded program and last configuration of a state machine: this is shared by all instances which are using 
+        /// the same state machine, so that a switch of the capture implementation does not leave a stale configuration
+        struct StateMachineCache {
+            uint16_t capture_prog_instr;
+            struct pio_program capture_prog;
+            int program_offset = -1;
+            uint program_pin_count = 0;
+            bool is_configured = false;
+            uint configured_pin_base = 0;
+            float configured_divider = 0;
+            uint configured_dma_chan = 0;
+            dma_channel_config dma_config;
+        };
+
+        /// Provides the cache of the used state machine: a function local static, so that we do not need C++17
+        StateMachineCache &cache() {
+            static StateMachineCache sm_cache[NUM_PIOS][NUM_PIO_STATE_MACHINES];
+            return sm_cache[pio_get_index(pio)][sm];
+        }
+
+        /// Provides the max frequency w/o side effects: before the calibration we use the system clock, which is 
+        /// the PIO sampling rate w/o divider
+        float planningFrequency() {
+            return isCalibrated() ? max_frequecy_value : clock_get_hz(clk_sys);
+        }
+
+        /// measures the max frequency before the first capture and makes sure that the plan is valid
+        void preparePlan() {
+            maxFrequency();
+            if (!capture_plan.is_valid){
+                updatePlan(PROFILE);
+            }
+        }
+
         /// starts the processing
         void start() {
             log("start()");
-            // if we are well above the limit we do not capture at all
-            if (logicAnalyzer().captureFrequency() > (1.5 * maxFrequency())){
+            preparePlan();
+            if (capture_plan.loop == LOOP_UNSUPPORTED){
                 setStatus(STOPPED);
                 // Send some dummy data to stop pulseview
                 write(0);
@@ -138,7 +212,7 @@ class PicoCapturePIO : public AbstractCapture {
             pin_base = logicAnalyzer().startPin();
             pin_count = logicAnalyzer().numberOfPins();
             n_samples = logicAnalyzer().readCount();
-            divider_value = calculateDivider(logicAnalyzer().captureFrequency());
+            divider_value = capture_plan.clock_divider;
 
             arm();
         }
@@ -146,14 +220,22 @@ class PicoCapturePIO : public AbstractCapture {
 
         /// determines the divider value 
         float calculateDivider(uint32_t frequecy_value_hz){
+            if (frequecy_value_hz==0) return 1.0;
             // 1.0 => maxCaptureFrequency()
-            float result = static_cast<float>(maxFrequency()) / static_cast<float>(frequecy_value_hz) ;
+            float result = planningFrequency() / static_cast<float>(frequecy_value_hz) ;
             log("divider: %f", result);
             return result < 1.0 ? 1.0 : result;
         }
 
-        /// intitialize the PIO
+        /// intitialize the PIO to capture the requested number of samples into the buffer
         void arm() {
+            arm(logicAnalyzer().buffer().data_ptr(), n_samples /4 * sizeof(PinBitArray));
+        }
+
+        /// intitialize the PIO to capture with the indicated number of 32 bit transfers: with ringBits > 0 the 
+        /// destination is used as ring buffer of 2^ringBits bytes which must be aligned to its size 
+        void arm(void *destination, uint32_t transfers, uint ringBits=0) {
+            PROBE_START(PROBE_PIO_ARM);
             log("arm()");
 
             log("- Init trigger");
@@ -164,28 +246,48 @@ class PicoCapturePIO : public AbstractCapture {
             bus_ctrl_hw->priority = BUSCTRL_BUS_PRIORITY_DMA_W_BITS | BUSCTRL_BUS_PRIORITY_DMA_R_BITS;
 
             // Load a program to capture n pins. This is just a single `in pins, n`
-            // instruction with a wrap.
-            uint16_t capture_prog_instr = pio_encode_in(pio_pins, pin_count);
-            struct pio_program capture_prog = {
-                .instructions = &capture_prog_instr,
-                .length = 1,
-                .origin = -1
-            };
-
-            uint offset = pio_add_program(pio, &capture_prog);
+            // instruction with a wrap: we only reload it when the number of pins has changed.
+            StateMachineCache &state = cache();
+            if (state.program_offset < 0 || state.program_pin_count != pin_count){
+                if (state.program_offset >= 0){
+                    pio_remove_program(pio, &state.capture_prog, state.program_offset);
+                }
+                state.capture_prog_instr = pio_encode_in(pio_pins, pin_count);
+                state.capture_prog.instructions = &state.capture_prog_instr;
+                state.capture_prog.length = 1;
+                state.capture_prog.origin = -1;
+                state.program_offset = pio_add_program(pio, &state.capture_prog);
+                state.program_pin_count = pin_count;
+                state.is_configured = false;
+            }
+            uint program_offset = state.program_offset;
 
             // Configure state machine to loop over this `in` instruction forever,
-            // with autopush enabled.
-            pio_sm_config c = pio_get_default_sm_config();
-            sm_config_set_in_pins(&c, pin_base);
-            sm_config_set_wrap(&c, offset, offset);
-            sm_config_set_clkdiv(&c, divider_value);
-            // Note that we may push at a < 32 bit threshold if pin_count does not
-            // divide 32. We are using shift-to-right, so the sample data ends up
-            // left-justified in the FIFO in this case, with some zeroes at the LSBs.
-            sm_config_set_in_shift(&c, true, true, 32);
-            sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
-            pio_sm_init(pio, sm, offset, &c);
+            // with autopush enabled: only necessary when the divider, pins or DMA channel have changed
+            if (!state.is_configured || state.configured_pin_base != pin_base || state.configured_divider != divider_value 
+                || state.configured_dma_chan != dma_chan){
+                pio_sm_config c = pio_get_default_sm_config();
+                sm_config_set_in_pins(&c, pin_base);
+                sm_config_set_wrap(&c, program_offset, program_offset);
+                sm_config_set_clkdiv(&c, divider_value);
+                // Note that we may push at a < 32 bit threshold if pin_count does not
+                // divide 32. We are using shift-to-right, so the sample data ends up
+                // left-justified in the FIFO in this case, with some zeroes at the LSBs.
+                sm_config_set_in_shift(&c, true, true, 32);
+                sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
+                pio_sm_init(pio, sm, program_offset, &c);
+
+                state.dma_config = dma_channel_get_default_config(dma_chan);
+                channel_config_set_read_increment(&state.dma_config, false);
+                channel_config_set_write_increment(&state.dma_config, true);
+                channel_config_set_transfer_data_size(&state.dma_config, DMA_SIZE_32);
+                channel_config_set_dreq(&state.dma_config, pio_get_dreq(pio, sm, false));
+
+                state.configured_pin_base = pin_base;
+                state.configured_divider = divider_value;
+                state.configured_dma_chan = dma_chan;
+                state.is_configured = true;
+            }
 
             /// arms the logic analyzer
             log("- Arming trigger");
@@ -194,27 +296,25 @@ class PicoCapturePIO : public AbstractCapture {
             // partial ISR contents left over from a previous run. sm_restart does this.
             pio_sm_clear_fifos(pio, sm);
             pio_sm_restart(pio, sm);
+            // restart does not reset the program counter
+            pio_sm_exec(pio, sm, pio_encode_jmp(program_offset));
 
-            dma_channel_config dma_config = dma_channel_get_default_config(dma_chan);
-            channel_config_set_read_increment(&dma_config, false);
-            channel_config_set_write_increment(&dma_config, true);
-            channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_32);
-            channel_config_set_dreq(&dma_config, pio_get_dreq(pio, sm, false));
-
-            n_transfers = n_samples /4 * sizeof(PinBitArray);
-            dma_channel_configure(dma_chan, &dma_config,
-                logicAnalyzer().buffer().data_ptr(),        // Destination pointer
+            dma_channel_config config = state.dma_config;
+            if (ringBits > 0){
+                channel_config_set_ring(&config, true, ringBits);
+            }
+            n_transfers = transfers;
+            dma_channel_configure(dma_chan, &config,
+                destination,        // Destination pointer
                 &pio->rxf[sm],      // Source pointer
                 n_transfers,        // Number of transfers
                 true                // Start immediately
             );
 
-            /// TODO proper trigger support
-            ///pio_sm_exec(pio, sm, pio_encode_wait_gpio(trigger_level, trigger_pin));
-
             run_time_us = 0;
             start_time = micros();
             pio_sm_set_enabled(pio, sm, true);
+            PROBE_END(PROBE_PIO_ARM);
         }
 
         // /// Determines the dma channel tranfer size
@@ -257,7 +357,9 @@ class PicoCapturePIO : public AbstractCapture {
         /// Wait for result and update run_time_us and buffer available
         void waitForResult() {
             log("waitForResult()");
+            PROBE_START(PROBE_PIO_WAIT);
             dma_channel_wait_for_finish_blocking(dma_chan);
+            PROBE_END(PROBE_PIO_WAIT);
             run_time_us = micros() - start_time;
             size_t record_count = n_transfers * 4 / sizeof(PinBitArray);
             logicAnalyzer().buffer().setAvailable(abort ? 0 : record_count);
@@ -266,6 +368,186 @@ class PicoCapturePIO : public AbstractCapture {
 
 };
 
+/**
+ * @brief PIO capturing with complex software triggers at the full PIO rate: PIO and DMA are filling a ring buffer 
+ * continuously while the CPU, which is idle anyway, scans the completed blocks word parallel with a BlockScanner. 
+ * The captured window is defined by the read and delay count relative to the matching position and is limited 
+ * to 3/4 of the ring. If the scanning can't keep up with the DMA, the capture is discarded as overrun.
+ * By default the SUMP trigger mask and values are used: edges and sequences can be defined via scanner().
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class PicoCapturePIORing : public PicoCapturePIO {
+    public:
+        /// Default Constructor
+        PicoCapturePIORing() : PicoCapturePIO() {
+        }
+
+        /// Destructor
+        ~PicoCapturePIORing() {
+            if (ring!=nullptr){
+                free(ring);
+            }
+        }
+
+        /// starts the capturing of the data
+        virtual void capture() override {
+            log("capture()");
+            if (captureRing()){
+                size_t count = logicAnalyzer().available();
+                write(logicAnalyzer().buffer().data_ptr(), count);
+                log("capture() - ended with %u records", count);
+            } else {
+                // unblock pulseview
+                write(0);
+                log("capture() - aborted");
+            }
+            setStatus(STOPPED);
+        }
+
+        /// Used to test the speed
+        virtual void captureAll() override {
+            captureRing();
+        }
+
+        /// In addition to the PIO capturing we support triggers
+        virtual CaptureCapabilities capabilities() override {
+            CaptureCapabilities result = PicoCapturePIO::capabilities();
+            result.is_trigger_supported = true;
+            return result;
+        }
+
+        /// Provides access to the trigger definition: if no stage is defined we use the SUMP trigger
+        BlockScanner &scanner() {
+            return custom_scanner;
+        }
+
+        /// Checks if the last capture was discarded because the scanning did not keep up with the DMA
+        bool isOverrun() {
+            return is_overrun;
+        }
+
+    protected:
+        // the DMA ring must be aligned to its size
+        uint8_t *ring = nullptr;
+        static const size_t ring_samples = (1 << PICO_RING_BITS) / sizeof(PinBitArray);
+        BlockScanner custom_scanner;
+        BlockScanner sump_scanner;
+        bool is_overrun = false;
+
+        /// Captures into the ring until the trigger was found and copies the window into the buffer: returns false if aborted
+        bool captureRing() {
+            if (ring==nullptr){
+                ring = (uint8_t*) aligned_alloc(1 << PICO_RING_BITS, 1 << PICO_RING_BITS);
+                if (ring==nullptr){
+                    log("not enough memory for the ring");
+                    return false;
+                }
+            }
+            preparePlan();
+            if (capture_plan.loop == LOOP_UNSUPPORTED){
+                log("The frequency %u is not supported!", logicAnalyzer().captureFrequency () );
+                return false;
+            }
+            abort = false;
+            is_overrun = false;
+            pin_base = logicAnalyzer().startPin();
+            pin_count = logicAnalyzer().numberOfPins();
+            divider_value = capture_plan.clock_divider;
+
+            // window relative to the match
+            size_t read_count = logicAnalyzer().readCount();
+            if (read_count > ring_samples / 4 * 3) read_count = ring_samples / 4 * 3;
+            if (read_count > logicAnalyzer().buffer().size()) read_count = logicAnalyzer().buffer().size();
+            size_t post = logicAnalyzer().delayCount() < read_count ? logicAnalyzer().delayCount() : read_count;
+            size_t pre = read_count - post;
+            n_samples = read_count;
+
+            BlockScanner &scanner = custom_scanner.stageCount() > 0 ? custom_scanner : sump_scanner;
+            if (&scanner == &sump_scanner){
+                sump_scanner.clear();
+                if (logicAnalyzer().triggerMask()){
+                    sump_scanner.addPattern(logicAnalyzer().triggerMask(), logicAnalyzer().triggerValues());
+                }
+            }
+            scanner.reset();
+
+            // the DMA is running until we stop it
+            arm(ring, 0xFFFFFFFF, PICO_RING_BITS);
+
+            // scan the completed blocks
+            uint64_t scanned = 0;
+            long long match = -1;
+            uint32_t loops = 0;
+            while (match < 0){
+                uint64_t written = samplesWritten();
+                if (written - scanned > ring_samples){
+                    is_overrun = true;
+                    break;
+                }
+                if (abort || (++loops % ABORT_CHECK_INTERVAL == 0 && isAbortRequested())) break;
+                if (written == scanned){
+                    if (!dma_channel_is_busy(dma_chan)) break;
+                    continue;
+                }
+                size_t pos = scanned % ring_samples;
+                size_t len = written - scanned < ring_samples - pos ? written - scanned : ring_samples - pos;
+                long idx = scanner.scan((const PinBitArray*) ring + pos, len);
+                if (idx >= 0){
+                    match = scanned + idx;
+                }
+                scanned += len;
+            }
+            if (match < 0){
+                stop();
+                log("no trigger - overrun: %d", is_overrun);
+                return false;
+            }
+            setStatus(TRIGGERED);
+
+            // wait for the post trigger samples
+            uint64_t start = (uint64_t) match >= pre ? match - pre : 0;
+            uint64_t end = match + post;
+            while (samplesWritten() < end && dma_channel_is_busy(dma_chan) && !abort);
+            uint64_t written = stop();
+            run_time_us = micros() - start_time;
+            if (written - start > ring_samples){
+                is_overrun = true;
+            }
+            if (abort || is_overrun || written < end){
+                log("capture discarded - overrun: %d", is_overrun);
+                return false;
+            }
+
+            // copy the window from the ring into the buffer
+            RingBuffer &buffer = logicAnalyzer().buffer();
+            size_t count = end - start;
+            size_t pos = start % ring_samples;
+            size_t first = count < ring_samples - pos ? count : ring_samples - pos;
+            const PinBitArray *data = (const PinBitArray*) ring;
+            buffer.clear();
+            memcpy(buffer.data_ptr(), data + pos, first * sizeof(PinBitArray));
+            memcpy(buffer.data_ptr() + first, data, (count - first) * sizeof(PinBitArray));
+            buffer.setAvailable(count);
+            log("trigger at %lu - window with %u entries", (unsigned long) match, count);
+            return true;
+        }
+
+        /// Provides the number of samples which have been written to the ring by the DMA
+        uint64_t samplesWritten() {
+            uint32_t remaining = dma_channel_hw_addr(dma_chan)->transfer_count;
+            return (uint64_t) (n_transfers - remaining) * 4 / sizeof(PinBitArray);
+        }
+
+        /// stops the PIO and the DMA and provides the number of written samples
+        uint64_t stop() {
+            pio_sm_set_enabled(pio, sm, false);
+            uint64_t result = samplesWritten();
+            dma_channel_abort(dma_chan);
+            return result;
+        }
+};
+
 } // namespace
 
-#endif
\ No newline at end of file
+#endif
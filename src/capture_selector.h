@@ -0,0 +1,172 @@
+/**
+ * @file capture_selector.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Selection of the best capture implementation for each request
+ */
+#pragma once
+
+#include "logic_analyzer.h"
+
+// Max number of capture implementations which can be managed by the CaptureSelector
+#ifndef CAPTURE_SELECTOR_MAX
+#define CAPTURE_SELECTOR_MAX 4
+#endif
+
+namespace logic_analyzer {
+
+/**
+ * @brief Manages multiple capture implementations and selects the most suitable one whenever the configuration 
+ * is changing: only implementations which support the requested frequency, trigger, continuous and demux mode 
+ * are considered. We prefer the implementations with an exact (hardware paced) timing and then the one with the 
+ * highest max frequency. If no implementation is supporting the request we use the first one, which will reject it.
+ * E.g. you can use the PicoCapturePIO for high rates w/o trigger and the Capture for everything else.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class CaptureSelector : public AbstractCapture {
+    public:
+        /// Default Constructor
+        CaptureSelector() : AbstractCapture() {
+        }
+
+        /// Adds a capture implementation: call before LogicAnalyzer.begin()!
+        bool add(AbstractCapture &capture) {
+            if (capture_count >= CAPTURE_SELECTOR_MAX) return false;
+            captures[capture_count++] = &capture;
+            if (selected_ptr==nullptr){
+                selected_ptr = &capture;
+            }
+            return true;
+        }
+
+        /// Provides the actually selected capture implementation
+        AbstractCapture &selected() {
+            return *selected_ptr;
+        }
+
+        /// starts the capturing of the data with the selected implementation
+        virtual void capture() override {
+            if (!capture_plan.is_valid){
+                updatePlan(PROFILE);
+            }
+            selected_ptr->capture();
+        }
+
+        /// Used to masure the speed of the selected implementation
+        virtual void captureAll() override {
+            selected_ptr->captureAll();
+        }
+
+        /// starts the capturing w/o blocking with the selected implementation
+        virtual bool captureStart() override {
+            if (!capture_plan.is_valid){
+                updatePlan(PROFILE);
+            }
+            return selected_ptr->captureStart();
+        }
+
+        /// continues the capturing with the selected implementation
+        virtual bool captureStep(size_t budget) override {
+            return selected_ptr->captureStep(budget);
+        }
+
+        /// Updates the plans of all implementations and selects the best one for the actual configuration
+        virtual void updatePlan(Event event) override {
+            for (int j=0; j<capture_count; j++){
+                captures[j]->updatePlan(event);
+            }
+            select();
+            capture_plan.is_valid = selected_ptr!=nullptr;
+        }
+
+        /// Provides the plan of the selected implementation
+        virtual CapturePlan &plan() override {
+            return selected_ptr!=nullptr ? selected_ptr->plan() : capture_plan;
+        }
+
+        /// Selects the implementation for the restored configuration and passes the plan (e.g. from a profile) to it
+        virtual void setPlan(const CapturePlan &plan) override {
+            select();
+            if (selected_ptr!=nullptr){
+                selected_ptr->setPlan(plan);
+            }
+            capture_plan.is_valid = selected_ptr!=nullptr;
+        }
+
+        /// Forwards the vendor commands to the managed implementations
+        virtual bool processCommand(int cmd) override {
+            for (int j=0; j<capture_count; j++){
+                if (captures[j]->processCommand(cmd)) return true;
+            }
+            return false;
+        }
+
+        /// Provides the capabilities which are covered by all implementations
+        virtual CaptureCapabilities capabilities() override {
+            CaptureCapabilities result;
+            for (int j=0; j<capture_count; j++){
+                CaptureCapabilities cap = captures[j]->capabilities();
+                if (cap.max_frequency > result.max_frequency) result.max_frequency = cap.max_frequency;
+                result.is_trigger_supported |= cap.is_trigger_supported;
+                result.is_continuous_supported |= cap.is_continuous_supported;
+                result.is_demux_supported |= cap.is_demux_supported;
+                result.is_exact_timing |= cap.is_exact_timing;
+            }
+            return result;
+        }
+
+    protected:
+        AbstractCapture *captures[CAPTURE_SELECTOR_MAX];
+        AbstractCapture *selected_ptr = nullptr;
+        int capture_count = 0;
+
+        virtual void setLogicAnalyzer(LogicAnalyzer &la) override {
+            AbstractCapture::setLogicAnalyzer(la);
+            for (int j=0; j<capture_count; j++){
+                captures[j]->setLogicAnalyzer(la);
+            }
+        }
+
+        /// selects the best implementation for the actual configuration
+        void select() {
+            if (capture_count==0) return;
+            AbstractCapture *best = nullptr;
+            CaptureCapabilities best_cap;
+            for (int j=0; j<capture_count; j++){
+                CaptureCapabilities cap = captures[j]->capabilities();
+                if (isSupported(cap) && (best==nullptr || isBetter(cap, best_cap))){
+                    best = captures[j];
+                    best_cap = cap;
+                }
+            }
+            selected_ptr = best!=nullptr ? best : captures[0];
+            log("selected capture: %d", indexOf(selected_ptr));
+        }
+
+        /// checks if the request can be handled with the indicated capabilities
+        bool isSupported(CaptureCapabilities &cap) {
+            // in demux mode the max frequency applies to the entries with 2 samples
+            uint64_t frequency = la_state.is_demux ? la_state.frequecy_value / 2 : la_state.frequecy_value;
+            if (frequency > cap.max_frequency) return false;
+            if (la_state.trigger_mask && !cap.is_trigger_supported) return false;
+            if (la_state.is_continuous_capture && !cap.is_continuous_supported) return false;
+            if (la_state.is_demux && !cap.is_demux_supported) return false;
+            return true;
+        }
+
+        /// exact timing is preferred, then the higher max frequency
+        bool isBetter(CaptureCapabilities &cap, CaptureCapabilities &other) {
+            if (cap.is_exact_timing != other.is_exact_timing) return cap.is_exact_timing;
+            return cap.max_frequency > other.max_frequency;
+        }
+
+        int indexOf(AbstractCapture *capture) {
+            for (int j=0; j<capture_count; j++){
+                if (captures[j]==capture) return j;
+            }
+            return -1;
+        }
+};
+
+} // namespace
@@ -0,0 +1,271 @@
+/**
+ * @file capture_setup_hold.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Measurement of the setup and hold times and of the skew of data channels relative to a clock channel
+ */
+#pragma once
+
+#include "logic_analyzer.h"
+
+// Number of violation positions which are kept: if there are more we keep the last ones
+#ifndef SETUP_HOLD_MAX_VIOLATIONS
+#define SETUP_HOLD_MAX_VIOLATIONS 16
+#endif
+
+namespace logic_analyzer {
+
+/**
+ * @brief Evaluates the timing of data channels relative to the active edge of a clock channel in a single pass 
+ * with the state kept between the blocks: the setup time is the number of samples from the last data change to the 
+ * clock edge, the hold time is the number of samples from the clock edge to the next data change and the skew is the 
+ * number of samples between the first and the last data change in a clock cycle. All times are in samples. 
+ * Samples w/o any change cost a single comparison. Setup and hold times below the limits are counted as violation 
+ * and we keep the positions of the last SETUP_HOLD_MAX_VIOLATIONS violations. 
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class SetupHoldChecker {
+    public:
+        /// Recorded violation
+        struct Violation {
+            uint32_t sample_pos;
+            bool is_hold;
+        };
+
+        /// Default Constructor
+        SetupHoldChecker() {
+            reset();
+        }
+
+        /// Defines the clock channel and the active edge
+        void setClock(int channel, bool rising=true) {
+            clock_mask = (PinBitArray)1 << channel;
+            is_rising = rising;
+        }
+
+        /// Defines the data channels
+        void setData(PinBitArray mask) {
+            data_mask = mask;
+        }
+
+        /// Defines the min setup and hold times in samples: shorter times are counted as violation
+        void setLimits(uint32_t setup, uint32_t hold) {
+            setup_limit = setup;
+            hold_limit = hold;
+        }
+
+        /// Removes all results
+        void reset() {
+            sample_count = 0;
+            has_last = false;
+            has_data_change = false;
+            has_clock = false;
+            is_hold_pending = false;
+            min_setup_value = UINT32_MAX;
+            min_hold_value = UINT32_MAX;
+            max_skew_value = 0;
+            setup_violations = 0;
+            hold_violations = 0;
+            violation_count = 0;
+            cycle_first = cycle_last = 0;
+            has_cycle_change = false;
+        }
+
+        /// Adds a block of samples
+        void add(const PinBitArray *data, size_t n) {
+            for (size_t j=0; j<n; j++){
+                add(data[j]);
+            }
+        }
+
+        /// Adds a single sample
+        inline void add(PinBitArray value) {
+            PinBitArray changes = (value ^ last) & (clock_mask | data_mask);
+            if (changes && has_last){
+                processChanges(changes, value);
+            }
+            last = value;
+            has_last = true;
+            sample_count++;
+        }
+
+        /// Provides the min observed setup time in samples: UINT32_MAX if no clock edge was preceded by a data change
+        uint32_t minSetup() {
+            return min_setup_value;
+        }
+
+        /// Provides the min observed hold time in samples: UINT32_MAX if no data change followed a clock edge
+        uint32_t minHold() {
+            return min_hold_value;
+        }
+
+        /// Provides the max number of samples between the first and the last data change in a clock cycle
+        uint32_t maxSkew() {
+            return max_skew_value;
+        }
+
+        /// Provides the number of setup violations
+        uint32_t setupViolations() {
+            return setup_violations;
+        }
+
+        /// Provides the number of hold violations
+        uint32_t holdViolations() {
+            return hold_violations;
+        }
+
+        /// Provides the number of kept violation positions
+        size_t violationCount() {
+            return violation_count < SETUP_HOLD_MAX_VIOLATIONS ? violation_count : SETUP_HOLD_MAX_VIOLATIONS;
+        }
+
+        /// Provides the indicated kept violation: 0 is the oldest
+        Violation &violation(size_t idx) {
+            size_t start = violation_count < SETUP_HOLD_MAX_VIOLATIONS ? 0 : violation_count % SETUP_HOLD_MAX_VIOLATIONS;
+            return violations[(start + idx) % SETUP_HOLD_MAX_VIOLATIONS];
+        }
+
+        /// Provides the number of evaluated samples
+        uint32_t samples() {
+            return sample_count;
+        }
+
+        /// Sends the samples, min setup, min hold, max skew, number of setup and hold violations and the number of 
+        /// kept violations followed by their positions as big endian uint32_t: the highest bit marks a hold violation
+        void writeTo(Stream &out) {
+            size_t n = violationCount();
+            uint32_t header[7] = {htonl(sample_count), htonl(min_setup_value), htonl(min_hold_value), htonl(max_skew_value), 
+                htonl(setup_violations), htonl(hold_violations), htonl(n)};
+            out.write((const uint8_t*)header, sizeof(header));
+            for (size_t j=0; j<n; j++){
+                Violation &v = violation(j);
+                uint32_t value = htonl((v.sample_pos & 0x7FFFFFFFUL) | (v.is_hold ? 0x80000000UL : 0));
+                out.write((const uint8_t*)&value, sizeof(value));
+            }
+            out.flush();
+        }
+
+    protected:
+        PinBitArray clock_mask = 1;
+        PinBitArray data_mask = 0;
+        PinBitArray last = 0;
+        bool is_rising = true;
+        bool has_last = false;
+        bool has_data_change = false;
+        bool has_clock = false;
+        bool is_hold_pending = false;
+        bool has_cycle_change = false;
+        uint32_t setup_limit = 0;
+        uint32_t hold_limit = 0;
+        uint32_t sample_count = 0;
+        uint32_t last_data_change = 0;
+        uint32_t last_clock = 0;
+        uint32_t cycle_first = 0;
+        uint32_t cycle_last = 0;
+        uint32_t min_setup_value = UINT32_MAX;
+        uint32_t min_hold_value = UINT32_MAX;
+        uint32_t max_skew_value = 0;
+        uint32_t setup_violations = 0;
+        uint32_t hold_violations = 0;
+        size_t violation_count = 0;
+        Violation violations[SETUP_HOLD_MAX_VIOLATIONS];
+
+        void processChanges(PinBitArray changes, PinBitArray value) {
+            uint32_t pos = sample_count;
+            // data changes are processed first: a change at the clock edge has a setup time of 0
+            if (changes & data_mask){
+                if (is_hold_pending){
+                    uint32_t hold = pos - last_clock;
+                    if (hold < min_hold_value) min_hold_value = hold;
+                    if (hold < hold_limit) addViolation(pos, true);
+                    is_hold_pending = false;
+                }
+                if (!has_cycle_change){
+                    cycle_first = pos;
+                    has_cycle_change = true;
+                }
+                cycle_last = pos;
+                last_data_change = pos;
+                has_data_change = true;
+            }
+            if ((changes & clock_mask) && ((value & clock_mask) != 0) == is_rising){
+                if (has_data_change){
+                    uint32_t setup = pos - last_data_change;
+                    if (setup < min_setup_value) min_setup_value = setup;
+                    if (setup < setup_limit) addViolation(pos, false);
+                }
+                // the first cycle might be incomplete
+                if (has_clock && has_cycle_change && cycle_last - cycle_first > max_skew_value){
+                    max_skew_value = cycle_last - cycle_first;
+                }
+                has_cycle_change = false;
+                has_clock = true;
+                last_clock = pos;
+                is_hold_pending = true;
+            }
+        }
+
+        void addViolation(uint32_t pos, bool isHold) {
+            if (isHold) hold_violations++; else setup_violations++;
+            Violation &v = violations[violation_count % SETUP_HOLD_MAX_VIOLATIONS];
+            v.sample_pos = pos;
+            v.is_hold = isHold;
+            violation_count++;
+        }
+};
+
+/**
+ * @brief Measures the setup and hold times of the data channels relative to the clock channel at max speed w/o 
+ * storing any samples (see SetupHoldChecker). The measurement runs until it is stopped with any other command (e.g. a RESET) 
+ * and the result can be requested at any time with the vendor command SUMP_VENDOR_GET_SETUP_HOLD.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class SetupHoldCapture : public Capture {
+    public:
+        /// Default Constructor
+        SetupHoldCapture(uint64_t maxCaptureFreq, uint64_t maxCaptureFreqThreshold) : Capture(maxCaptureFreq, maxCaptureFreqThreshold) {
+        }
+
+        /// Provides access to the measurement to define the channels and limits and to query the results
+        SetupHoldChecker &checker() {
+            return setup_hold;
+        }
+
+        /// evaluates the samples until the processing is stopped
+        virtual void capture() override {
+            log("capture setup hold");
+            PinReader &reader = *pin_reader_ptr;
+            setup_hold.reset();
+            TRACE_BEGIN("setup hold");
+            while(true){
+                for (int j=0; j<ABORT_CHECK_INTERVAL; j++){
+                    setup_hold.add(reader.readAll());
+                }
+                // the result can be requested while we are measuring
+                if (stream_ptr->available()>0 && stream_ptr->peek()==SUMP_VENDOR_GET_SETUP_HOLD){
+                    stream_ptr->read();
+                    setup_hold.writeTo(*stream_ptr);
+                }
+                if (la_state.status_value == STOPPED || isAbortRequested()){
+                    break;
+                }
+            }
+            TRACE_END("setup hold");
+            setStatus(STOPPED);
+        }
+
+        /// Provides the result when we are not measuring
+        virtual bool processCommand(int cmd) override {
+            if (cmd != SUMP_VENDOR_GET_SETUP_HOLD) return false;
+            log("=>SUMP_VENDOR_GET_SETUP_HOLD");
+            setup_hold.writeTo(*stream_ptr);
+            return true;
+        }
+
+    protected:
+        SetupHoldChecker setup_hold;
+};
+
+} // namespace
@@ -11,6 +11,8 @@
 #define START_PIN 0
 #define PIN_COUNT sizeof(PinBitArray)*8
 #define DESCRIPTION "Arduino-AVR"
+// the cycles are derived from micros() which has a resolution of 4us
+#define CYCLE_COUNT_RESOLUTION (4 * clockCyclesPerMicrosecond())
 
 // Software Serial for logging
 #define LOG soft_serial
@@ -43,9 +45,9 @@ class PinReader  {
           this->start_pin = startPin;
         }
 
-        /// reads all pins and provides the result as bitmask -  PORTD:pins 0 to 7 / PORTB: pins 8 to 13 
+        /// reads all input pins and provides the result as bitmask -  PIND:pins 0 to 7 / PINB: pins 8 to 13 
         inline PinBitArray readAll() {
-            uint16_t result = ((uint16_t)PORTB & B00111111) << 8 | PORTD;
+            uint16_t result = ((uint16_t)PINB & B00111111) << 8 | PIND;
             return result >> start_pin;
         }
 
@@ -53,6 +55,11 @@ class PinReader  {
         int start_pin;
 };
 
+/// There is no cycle counter: so we calculate it from the micros() with a resolution of 4us
+inline uint32_t cycleCount() {
+    return micros() * clockCyclesPerMicrosecond();
+}
+
 
 } // namespace
 
@@ -16,6 +16,8 @@
 #define START_PIN 19
 #define PIN_COUNT sizeof(PinBitArray)*8
 #define DESCRIPTION "Arduino-ESP32"
+// the cycle counter is running at the actual cpu frequency
+#define CYCLE_COUNT_FREQUENCY (getCpuFrequencyMhz() * 1000000UL)
 
 
 namespace logic_analyzer {
@@ -46,6 +48,11 @@ class PinReader {
         int start_pin;
 };
 
+/// Provides the actual processor cycle count
+inline uint32_t cycleCount() {
+    return ESP.getCycleCount();
+}
+
 
 } // namespace
 
@@ -15,6 +15,8 @@
 #define START_PIN 12
 #define PIN_COUNT 4
 #define DESCRIPTION "Arduino-ESP8266"
+// the cycle counter is running at the actual cpu frequency
+#define CYCLE_COUNT_FREQUENCY (ESP.getCpuFreqMHz() * 1000000UL)
 
 
 namespace logic_analyzer {
@@ -45,6 +47,11 @@ class PinReader  {
         int start_pin;
 };
 
+/// Provides the actual processor cycle count
+inline uint32_t cycleCount() {
+    return ESP.getCycleCount();
+}
+
 
 } // namespace
 
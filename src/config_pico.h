@@ -11,6 +11,7 @@
 #ifdef ARDUINO_ARCH_RP2040
 #include "Arduino.h"
 #include <stdarg.h>     /* va_list, va_start, va_arg, va_end */
+#include "hardware/structs/systick.h"
 
 // processor specific settings
 #define MAX_CAPTURE_SIZE 65535  
@@ -21,6 +22,8 @@
 #define START_PIN 6
 #define PIN_COUNT sizeof(PinBitArray)*8
 #define DESCRIPTION "Arduino-Pico"
+// the SysTick is only 24 bits
+#define CYCLE_COUNT_MASK 0xFFFFFFUL
 
 namespace logic_analyzer {
 
@@ -47,6 +50,16 @@ class PinReader  {
         int start_pin;
 };
 
+/// Provides the actual processor cycle count: we use the SysTick which is counting down
+inline uint32_t cycleCount() {
+    if ((systick_hw->csr & 1)==0){
+        systick_hw->rvr = 0xFFFFFF;
+        // enable with processor clock as source
+        systick_hw->csr = 0x5;
+    }
+    return 0xFFFFFF - systick_hw->cvr;
+}
+
 }
 
 #endif
\ No newline at end of file
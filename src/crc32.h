@@ -0,0 +1,102 @@
+/**
+ * @file crc32.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief CRC32 checksums of captured data
+ */
+#pragma once
+
+#include "Arduino.h"
+
+// Allow the slice-by-8 algorithm which needs 8 KB of tables: on AVR we always process 4 bits at a time with a 64 
+// byte table
+#ifndef CRC32_SLICE_BY_8
+#ifdef AVR
+#define CRC32_SLICE_BY_8 0
+#else
+#define CRC32_SLICE_BY_8 1
+#endif
+#endif
+
+namespace logic_analyzer {
+
+/**
+ * @brief Standard CRC32 (IEEE 802.3, reflected polynomial 0xEDB88320) as used by zlib: the result of a block can be 
+ * passed as start value to continue the calculation with the next block. We process 4 bits at a time with a 64 byte 
+ * table: after begin() (with CRC32_SLICE_BY_8) we process 8 bytes with 8 lookups in tables which are allocated on 
+ * the heap, so that the 8 KB are only used when the checksums are needed.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class CRC32 {
+    public:
+        /// Allocates and calculates the slice-by-8 tables: returns false if they are not available
+        static bool begin() {
+#if CRC32_SLICE_BY_8
+            uint32_t (*&table)[256] = tables();
+            if (table == nullptr){
+                table = new uint32_t[8][256];
+                if (table == nullptr) return false;
+                for (uint32_t j=0; j<256; j++){
+                    uint32_t crc = j;
+                    for (int bit=0; bit<8; bit++){
+                        crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+                    }
+                    table[0][j] = crc;
+                }
+                for (int n=1; n<8; n++){
+                    for (int j=0; j<256; j++){
+                        table[n][j] = (table[n-1][j] >> 8) ^ table[0][table[n-1][j] & 0xFF];
+                    }
+                }
+            }
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        /// Calculates the checksum of the data: use the result of the last block as crc to continue the calculation
+        static uint32_t calculate(const void *data, size_t len, uint32_t crc=0) {
+            const uint8_t *ptr = (const uint8_t *) data;
+            crc = ~crc;
+#if CRC32_SLICE_BY_8
+            const uint32_t (*t)[256] = tables();
+            if (t != nullptr){
+                while (len >= 8){
+                    // assembled from the bytes, so that it also works on big endian architectures
+                    uint32_t one = (ptr[0] | ptr[1] << 8 | (uint32_t)ptr[2] << 16 | (uint32_t)ptr[3] << 24) ^ crc;
+                    uint32_t two = ptr[4] | ptr[5] << 8 | (uint32_t)ptr[6] << 16 | (uint32_t)ptr[7] << 24;
+                    crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+                          t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+                    ptr += 8;
+                    len -= 8;
+                }
+                while (len--){
+                    crc = (crc >> 8) ^ t[0][(crc ^ *ptr++) & 0xFF];
+                }
+                return ~crc;
+            }
+#endif
+            static const uint32_t nibbles[16] = {
+                0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+                0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+            while (len--){
+                crc ^= *ptr++;
+                crc = (crc >> 4) ^ nibbles[crc & 0x0F];
+                crc = (crc >> 4) ^ nibbles[crc & 0x0F];
+            }
+            return ~crc;
+        }
+
+    protected:
+#if CRC32_SLICE_BY_8
+        /// Provides the 8 lookup tables (nullptr before begin()): table n is processing a byte which is followed by n bytes
+        static uint32_t (*&tables())[256] {
+            static uint32_t (*table)[256] = nullptr;
+            return table;
+        }
+#endif
+};
+
+} // namespace
@@ -0,0 +1,196 @@
+/**
+ * @file decoder.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Framework for protocol decoders which are evaluating the captured data in place
+ */
+#pragma once
+
+#include "Arduino.h"
+#include "config.h"
+#include "network.h"
+
+// Number of decoder events which are kept: if there are more we overwrite the oldest
+#ifndef DECODER_EVENT_COUNT
+#define DECODER_EVENT_COUNT 64
+#endif
+
+// Max number of decoders in a registry
+#ifndef DECODER_MAX
+#define DECODER_MAX 4
+#endif
+
+// Max number of channels which can be assigned to a decoder
+#ifndef DECODER_MAX_CHANNELS
+#define DECODER_MAX_CHANNELS 4
+#endif
+
+namespace logic_analyzer {
+
+/**
+ * @brief Compact result of a decoder: the meaning of type and value is defined by the decoder
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct DecoderEvent {
+    uint32_t sample_pos;
+    uint8_t decoder;
+    uint8_t type;
+    uint16_t value;
+};
+
+/**
+ * @brief Ring of the decoder events: if it is full we overwrite the oldest events and count them as dropped
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class DecoderEvents {
+    public:
+        /// Adds an event
+        void add(uint32_t samplePos, uint8_t decoder, uint8_t type, uint16_t value) {
+            DecoderEvent &event = events[write_count % DECODER_EVENT_COUNT];
+            event.sample_pos = samplePos;
+            event.decoder = decoder;
+            event.type = type;
+            event.value = value;
+            write_count++;
+        }
+
+        /// Removes all events
+        void clear() {
+            write_count = 0;
+        }
+
+        /// Provides the number of kept events
+        size_t size() {
+            return write_count < DECODER_EVENT_COUNT ? write_count : DECODER_EVENT_COUNT;
+        }
+
+        /// Provides the number of overwritten events
+        size_t dropped() {
+            return write_count - size();
+        }
+
+        /// Provides the indicated event: 0 is the oldest
+        DecoderEvent &operator[](size_t idx) {
+            size_t start = write_count < DECODER_EVENT_COUNT ? 0 : write_count % DECODER_EVENT_COUNT;
+            return events[(start + idx) % DECODER_EVENT_COUNT];
+        }
+
+        /// Sends the number of events and of the dropped events followed by the events (sample position, decoder, 
+        /// type and value) in big endian format
+        void writeTo(Stream &out) {
+            uint32_t header[2] = {htonl((uint32_t)size()), htonl((uint32_t)dropped())};
+            out.write((const uint8_t*)header, sizeof(header));
+            for (size_t j=0; j<size(); j++){
+                DecoderEvent &event = (*this)[j];
+                uint8_t record[8];
+                uint32_t pos = htonl(event.sample_pos);
+                uint16_t value = htons(event.value);
+                memcpy(record, &pos, sizeof(pos));
+                record[4] = event.decoder;
+                record[5] = event.type;
+                memcpy(record + 6, &value, sizeof(value));
+                out.write(record, sizeof(record));
+            }
+            out.flush();
+        }
+
+    protected:
+        DecoderEvent events[DECODER_EVENT_COUNT];
+        size_t write_count = 0;
+};
+
+/**
+ * @brief Abstract protocol decoder: it receives the captured data as read only blocks in the order of the samples 
+ * and keeps its state between the blocks, so that the samples never need to be copied. The channels are assigned 
+ * to the roles which are defined by the decoder (e.g. RX for a serial decoder). 
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class Decoder {
+    public:
+        /// Assigns the channel to the indicated role
+        void setChannel(int role, int channel) {
+            if (role < DECODER_MAX_CHANNELS){
+                channel_masks[role] = (PinBitArray)1 << channel;
+            }
+        }
+
+        /// Restarts the decoding: called before the first block
+        virtual void reset() {
+        }
+
+        /// Decodes the block: pos is the sample position of the first entry
+        virtual void decode(const PinBitArray *data, size_t n, uint32_t pos, DecoderEvents &events) = 0;
+
+        /// Defines the id which is reported in the events
+        void setId(uint8_t id) {
+            decoder_id = id;
+        }
+
+        /// Provides the id which is reported in the events
+        uint8_t id() {
+            return decoder_id;
+        }
+
+    protected:
+        PinBitArray channel_masks[DECODER_MAX_CHANNELS] = {0};
+        uint8_t decoder_id = 0;
+
+        /// Provides the mask of the channel which is assigned to the role
+        PinBitArray channelMask(int role) {
+            return channel_masks[role];
+        }
+};
+
+/**
+ * @brief Runs several decoders on the same captured data: the decoders are identified by the index in which 
+ * they have been added and all of them are writing into the same event ring.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class DecoderRegistry {
+    public:
+        /// Adds a decoder: returns false if there is no more space
+        bool add(Decoder &decoder) {
+            if (decoder_count >= DECODER_MAX) return false;
+            decoder.setId(decoder_count);
+            decoders[decoder_count++] = &decoder;
+            return true;
+        }
+
+        /// Provides the number of registered decoders
+        int size() {
+            return decoder_count;
+        }
+
+        /// Restarts all decoders with the sample position 0: the events are kept
+        void reset() {
+            sample_pos = 0;
+            for (int j=0; j<decoder_count; j++){
+                decoders[j]->reset();
+            }
+        }
+
+        /// Provides the next block of samples to all decoders
+        void decode(const PinBitArray *data, size_t n) {
+            for (int j=0; j<decoder_count; j++){
+                decoders[j]->decode(data, n, sample_pos, decoder_events);
+            }
+            sample_pos += n;
+        }
+
+        /// Provides access to the events
+        DecoderEvents &events() {
+            return decoder_events;
+        }
+
+    protected:
+        Decoder *decoders[DECODER_MAX];
+        int decoder_count = 0;
+        uint32_t sample_pos = 0;
+        DecoderEvents decoder_events;
+};
+
+} // namespace
@@ -0,0 +1,98 @@
+/**
+ * @file decoder_uart.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Decoder for asynchronous serial data
+ */
+#pragma once
+
+#include "decoder.h"
+
+namespace logic_analyzer {
+
+/// Channel roles of the UARTDecoder
+enum UARTRole : uint8_t {UART_RX};
+
+/// Event types of the UARTDecoder: the value is the received data
+enum UARTEventType : uint8_t {UART_DATA = 1, UART_FRAME_ERROR};
+
+/**
+ * @brief Decodes asynchronous serial data (idle high, start bit, LSB first, 1 stop bit) on the UART_RX channel. 
+ * The bit length is given in samples, so it is the capturing frequency divided by the baud rate: we use a 
+ * 8 bit fixed point counter, so that fractional bit lengths do not accumulate. Each character is reported at the 
+ * position of the start bit as UART_DATA or as UART_FRAME_ERROR if the stop bit is missing. 
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class UARTDecoder : public Decoder {
+    public:
+        /// Default Constructor
+        UARTDecoder() {
+        }
+
+        /// Defines the number of samples per bit (capturing frequency / baud rate) and the number of data bits
+        void setBitLength(float samplesPerBit, uint8_t dataBits=8) {
+            bit_length = samplesPerBit * 256;
+            data_bits = dataBits;
+        }
+
+        /// Restarts the decoding: we wait for the line to be idle
+        virtual void reset() override {
+            bit_idx = STATE_IDLE;
+            is_line_high = false;
+        }
+
+        /// Decodes the block: pos is the sample position of the first entry
+        virtual void decode(const PinBitArray *data, size_t n, uint32_t pos, DecoderEvents &events) override {
+            PinBitArray rx = channelMask(UART_RX);
+            for (size_t j=0; j<n; j++){
+                bool level = (data[j] & rx) != 0;
+                if (bit_idx == STATE_IDLE){
+                    // falling edge: start bit
+                    if (is_line_high && !level){
+                        start_pos = pos + j;
+                        remaining = bit_length / 2;
+                        bit_idx = STATE_START_BIT;
+                        value = 0;
+                    }
+                    is_line_high = level;
+                    continue;
+                }
+                if (remaining >= 256){
+                    remaining -= 256;
+                    continue;
+                }
+                // we are in the middle of a bit
+                remaining += bit_length - 256;
+                if (bit_idx == STATE_START_BIT){
+                    if (level){
+                        // glitch: no start bit
+                        bit_idx = STATE_IDLE;
+                        is_line_high = true;
+                        continue;
+                    }
+                } else if (bit_idx < data_bits){
+                    if (level) value |= 1 << bit_idx;
+                } else {
+                    events.add(start_pos, decoder_id, level ? UART_DATA : UART_FRAME_ERROR, value);
+                    bit_idx = STATE_IDLE;
+                    is_line_high = level;
+                    continue;
+                }
+                bit_idx++;
+            }
+        }
+
+    protected:
+        static const int STATE_IDLE = -2;
+        static const int STATE_START_BIT = -1;
+        uint32_t bit_length = 256;
+        uint32_t remaining = 0;
+        uint32_t start_pos = 0;
+        uint16_t value = 0;
+        uint8_t data_bits = 8;
+        int bit_idx = STATE_IDLE;
+        bool is_line_high = false;
+};
+
+} // namespace
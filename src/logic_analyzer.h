@@ -10,6 +10,11 @@
 #include "Arduino.h"
 #include "config.h"
 #include "network.h"
+#include "probes.h"
+#include "trace.h"
+#include "block_scanner.h"
+#include "decoder.h"
+#include "crc32.h"
 
 // Max numbers of logged characters in a line
 #ifndef LOG_BUFFER_SIZE
@@ -21,6 +26,61 @@
 #define DUMP_RECORD_SIZE 1024*1
 #endif
 
+// Default max number of samples which are processed in one cooperative capture step
+#ifndef CAPTURE_STEP_BUDGET
+#define CAPTURE_STEP_BUDGET 256
+#endif
+
+// Number of samples after which the blocking capture loops check for a pending command
+#ifndef ABORT_CHECK_INTERVAL
+#define ABORT_CHECK_INTERVAL 1024
+#endif
+
+// Default buffer size in bytes of the BufferedStream
+#ifndef OUTPUT_BUFFER_SIZE
+#define OUTPUT_BUFFER_SIZE 512
+#endif
+
+// Number of samples which are captured at max speed to determine the automatic timebase
+#ifndef AUTO_TIMEBASE_SCAN_SIZE
+#define AUTO_TIMEBASE_SCAN_SIZE 1024
+#endif
+
+// Number of samples which the automatic timebase provides for the shortest pulse
+#ifndef AUTO_TIMEBASE_SAMPLES_PER_PULSE
+#define AUTO_TIMEBASE_SAMPLES_PER_PULSE 4
+#endif
+
+// Default number of entries in a frame of the framed dump
+#ifndef FRAMED_DUMP_BLOCK_SIZE
+#define FRAMED_DUMP_BLOCK_SIZE 256
+#endif
+
+// Default number of frames of the framed dump which can be sent w/o acknowledgement
+#ifndef FRAMED_DUMP_WINDOW
+#define FRAMED_DUMP_WINDOW 4
+#endif
+
+// Time in ms w/o acknowledgement after which the oldest unacknowledged frame is sent again
+#ifndef FRAMED_DUMP_TIMEOUT_MS
+#define FRAMED_DUMP_TIMEOUT_MS 500
+#endif
+
+// Number of timeouts w/o progress after which the framed dump is given up
+#ifndef FRAMED_DUMP_RETRIES
+#define FRAMED_DUMP_RETRIES 10
+#endif
+
+// Magic number at the start of each window header in the triggered streaming mode: "LASW"
+#ifndef STREAM_WINDOW_MAGIC
+#define STREAM_WINDOW_MAGIC 0x4C415357UL
+#endif
+
+// Number of capture profiles which can be stored on the device
+#ifndef LA_PROFILE_COUNT
+#define LA_PROFILE_COUNT 4
+#endif
+
 // Supported Commands
 #define SUMP_RESET 0x00
 #define SUMP_ARM   0x01
@@ -36,25 +96,73 @@
 #define SUMP_SET_RLE 0x0100
 #define SUMP_GET_METADATA 0x04
 
+// Flags
+#define SUMP_FLAG_DEMUX 0x01
+
+// Vendor specific commands
+#define SUMP_VENDOR_GET_TIMESTAMPS 0x30
+#define SUMP_VENDOR_GET_FREQUENCY 0x31
+#define SUMP_VENDOR_GET_SEGMENTS 0x32
+#define SUMP_VENDOR_GET_HISTOGRAM 0x33
+#define SUMP_VENDOR_GET_SETUP_HOLD 0x34
+#define SUMP_VENDOR_GET_DECODER_EVENTS 0x35
+#define SUMP_VENDOR_GET_CHECKSUMS 0x36
+#define SUMP_VENDOR_ARM_PROFILE 0x40 // + slot
+#define SUMP_VENDOR_SAVE_PROFILE 0xA0
+#define SUMP_VENDOR_RESEND_BLOCK 0xA1
+#define SUMP_VENDOR_FRAMED_DUMP 0xA2
+#define SUMP_VENDOR_ACK 0xA3
+#define SUMP_VENDOR_NAK 0xA4
+
+// Vendor specific metadata: capability bits
+#define SUMP_META_CAPABILITIES 0x2F
+#define LA_CAPABILITY_CHECKSUMS 0x01
+#define LA_CAPABILITY_FRAMED_DUMP 0x02
+#define LA_CAPABILITY_DEMUX 0x04
+
+// The OLS demux layout needs 2 samples of 16 channels in one entry
+#define LA_IS_DEMUX_SUPPORTED (sizeof(PinBitArray) >= 4)
+
+// Sync byte at the start of each frame of the framed dump
+#define FRAMED_DUMP_SYNC 0xA5
+
 namespace logic_analyzer {
 
 /// forward declarations
 class AbstractCapture;
 class Capture;
+class CaptureSelector;
 class LogicAnalyzer;
 class RingBuffer;
+class TimestampLog;
+class BlockChecksums;
+class FramedDump;
 
 
 /// Logic Analzyer Capturing Status
 enum Status : uint8_t {STOPPED, ARMED, TRIGGERED};
 
+/// Processing phase of the cooperative capturing
+enum CapturePhase : uint8_t {IDLE, WAITING_FOR_TRIGGER, SAMPLING, DUMPING};
+
+/// Capture loop which has been selected by the CapturePlan
+enum CaptureLoop : uint8_t {LOOP_UNSUPPORTED, LOOP_PACED, LOOP_MAX_SPEED, LOOP_DEMUX, LOOP_DEMUX_MAX_SPEED, LOOP_CONTINUOUS, LOOP_CONTINUOUS_MAX_SPEED};
+
 /// Events
-enum Event : uint8_t {RESET, STATUS, CAPUTRE_SIZE, CAPTURE_FREQUNCY,TRIGGER_VALUES,TRIGGER_MASK, READ_DLEAY_COUNT, FLAGS};
+enum Event : uint8_t {RESET, STATUS, CAPUTRE_SIZE, CAPTURE_FREQUNCY,TRIGGER_VALUES,TRIGGER_MASK, READ_DLEAY_COUNT, FLAGS, PROFILE};
 typedef void (*EventHandler)(Event event);
 
 PinReader *pin_reader_ptr = nullptr;
 /// common access to buffer
 RingBuffer *buffer_ptr = nullptr;;
+/// optional timestamps of the capturing
+TimestampLog *timestamps_ptr = nullptr;
+/// optional checksums of the dumped blocks
+BlockChecksums *checksums_ptr = nullptr;
+/// optional framed and acknowledged dump
+FramedDump *framed_dump_ptr = nullptr;
+/// optional decoders which are evaluating the captured data
+DecoderRegistry *decoders_ptr = nullptr;
 /// Logger Stream
 Stream *logger_ptr = nullptr;
 /// Command stream
@@ -62,12 +170,15 @@ Stream *stream_ptr = nullptr;
 
 /// writes the status of all activated pins to the capturing device
 void write(PinBitArray bits) {
-    // write 4 bytes
-    stream_ptr->write(htonl(bits));
+    PROBE_START(PROBE_OUTPUT);
+    // same byte layout as the buffered dump
+    stream_ptr->write((const uint8_t*)&bits, sizeof(PinBitArray));
+    PROBE_END(PROBE_OUTPUT);
 }
 
 // writes a buffer of PinBitArray
 void write(PinBitArray *buff, size_t n_samples) {
+    PROBE_START(PROBE_OUTPUT);
     int written = 0;
     int open = n_samples * sizeof(PinBitArray);
     while(open > 0){
@@ -75,11 +186,12 @@ void write(PinBitArray *buff, size_t n_samples) {
         written += result;
         open -= result;
     }
+    PROBE_END(PROBE_OUTPUT);
 }
 
-// writes a buffer of uint32_t values
-void write(uint32_t *buff, size_t n_samples) {
-     write(reinterpret_cast <PinBitArray *>(buff), n_samples * sizeof(uint32_t) / sizeof(PinBitArray));
+// writes a buffer of uint32_t values: const, so that it does not clash with the above if PinBitArray is uint32_t
+void write(const uint32_t *buff, size_t n_samples) {
+     write(reinterpret_cast <PinBitArray *>(const_cast<uint32_t *>(buff)), n_samples * sizeof(uint32_t) / sizeof(PinBitArray));
 }
 
 
@@ -126,6 +238,94 @@ class Sump4ByteComandArg {
 
 };
 
+/**
+ * @brief Stream which collects the written data in a buffer and forwards it in big chunks to the wrapped
+ * output Stream. This saves the driver call per sample in the continuous capturing. Reading is just forwarded.
+ * Use it instead of the Stream that is passed to LogicAnalyzer::begin().
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class BufferedStream : public Stream {
+    public:
+        BufferedStream(Stream &out, size_t bufferSize=OUTPUT_BUFFER_SIZE){
+            p_out = &out;
+            buffer = new uint8_t[bufferSize];
+            buffer_size = buffer==nullptr ? 0 : bufferSize;
+        }
+
+        ~BufferedStream(){
+            if (buffer!=nullptr){
+                delete[] buffer;
+            }
+        }
+
+        virtual int available() override {
+            return p_out->available();
+        }
+
+        virtual int read() override {
+            return p_out->read();
+        }
+
+        virtual int peek() override {
+            return p_out->peek();
+        }
+
+        /// adds a single byte to the buffer
+        virtual size_t write(uint8_t value) override {
+            if (pos>=buffer_size){
+                flushBuffer();
+                if (buffer_size==0) return p_out->write(value);
+            }
+            buffer[pos++] = value;
+            return 1;
+        }
+
+        /// adds the data to the buffer - big blocks are written directly 
+        virtual size_t write(const uint8_t *data, size_t len) override {
+            if (pos+len > buffer_size){
+                flushBuffer();
+            }
+            if (len >= buffer_size){
+                writeAll(data, len);
+            } else {
+                memcpy(buffer+pos, data, len);
+                pos += len;
+            }
+            return len;
+        }
+
+        using Print::write;
+
+        virtual int availableForWrite() override {
+            return buffer_size - pos;
+        }
+
+        /// writes the buffered data and flushes the wrapped Stream
+        virtual void flush() override {
+            flushBuffer();
+            p_out->flush();
+        }
+
+    protected:
+        Stream *p_out = nullptr;
+        uint8_t *buffer = nullptr;
+        size_t buffer_size = 0;
+        size_t pos = 0;
+
+        void flushBuffer() {
+            writeAll(buffer, pos);
+            pos = 0;
+        }
+
+        void writeAll(const uint8_t *data, size_t len){
+            size_t open = len;
+            while(open > 0){
+                open -= p_out->write(data + (len - open), open);
+            }
+        }
+};
+
 /**
  * @brief Data is captured in a ring buffer. If the buffer is full we overwrite the oldest entries....
  * @author Phil Schatzmann
@@ -135,7 +335,8 @@ class RingBuffer {
     public:
         RingBuffer(size_t size){
             this->size_count = size + 10;
-            data = new PinBitArray[this->size_count];
+            // the positions are running from 0 to size_count
+            data = new PinBitArray[this->size_count + 1];
             if (data==nullptr){
                 log("Requested capture size is too big");
                 this->size_count = 0;
@@ -150,6 +351,7 @@ class RingBuffer {
 
         /// adds an entry - if there is no more space we overwrite the oldest value
         void write(PinBitArray value){
+            PROBE_START(PROBE_BUFFER_WRITE);
             if (ignore_count > 0) {
                 ignore_count--;
                 return;
@@ -163,6 +365,7 @@ class RingBuffer {
             } else {
                 read_pos = write_pos+1;
             }
+            PROBE_END(PROBE_BUFFER_WRITE);
         }
 
         /// reads the next available entry from the buffer
@@ -178,6 +381,42 @@ class RingBuffer {
             return result;
         }
 
+        /// Provides the contiguous block of available entries which starts offset entries after the oldest one in place (w/o copy) 
+        /// and keeps them in the buffer. The block is valid until the next write.
+        size_t peekBlock(size_t offset, const PinBitArray *&block, size_t max_len){
+            if (offset >= available_count){
+                return 0;
+            }
+            size_t pos = read_pos > size_count ? 0 : read_pos;
+            pos += offset;
+            if (pos > size_count){
+                pos -= size_count + 1;
+            }
+            size_t len = size_count + 1 - pos;
+            if (len > available_count - offset) len = available_count - offset;
+            if (len > max_len) len = max_len;
+            block = data + pos;
+            return len;
+        }
+
+        /// Provides the next contiguous block of available entries in place (w/o copy) and removes them from the buffer. 
+        /// The block is valid until the next write.
+        size_t readBlock(PinBitArray *&block, size_t max_len){
+            if (available_count==0){
+                return 0;
+            }
+            if (read_pos>size_count){
+                read_pos = 0;
+            }
+            size_t len = size_count + 1 - read_pos;
+            if (len > available_count) len = available_count;
+            if (len > max_len) len = max_len;
+            block = data + read_pos;
+            read_pos += len;
+            available_count -= len;
+            return len;
+        }
+
         /// 1 SUMP record has 4 bytes - We privide the requested number of buffered values in the output format
         size_t readBuffer(uint32_t *result, size_t read_len){
             size_t result_len;
@@ -242,6 +481,289 @@ class RingBuffer {
         PinBitArray *data;
 };
 
+/**
+ * @brief Optional side channel to the captured data: we record the cycle counter every n samples, so that the host
+ * can correct the timebase of long captures or find the places where the timing was disturbed. The interval should
+ * be short enough to have less than one overflow of the cycle counter between two entries: so we also report the 
+ * frequency, the resolution and the width in bits of the cycle counter.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class TimestampLog {
+    public:
+        /// Recorded timestamp
+        struct Entry {
+            uint32_t sample_pos;
+            uint32_t cycles;
+        };
+
+        TimestampLog(uint16_t interval, size_t maxCount){
+            interval_count = interval;
+            entries = new Entry[maxCount];
+            max_count = entries==nullptr ? 0 : maxCount;
+        }
+
+        ~TimestampLog(){
+            if (entries!=nullptr){
+                delete[] entries;
+            }
+        }
+
+        /// records the actual cycle count for the indicated sample position
+        inline void record(uint32_t samplePos){
+            if (count < max_count){
+                entries[count].cycles = cycleCount();
+                entries[count].sample_pos = samplePos;
+                count++;
+            }
+        }
+
+        /// removes all entries
+        void clear() {
+            count = 0;
+        }
+
+        /// Provides the number of samples between two timestamps
+        uint16_t interval() {
+            return interval_count;
+        }
+
+        /// Provides the number of recorded timestamps
+        size_t size() {
+            return count;
+        }
+
+        /// Provides the indicated entry
+        Entry &operator[](size_t idx){
+            return entries[idx];
+        }
+
+        /// writes the interval, the counter frequency in Hz, the counter resolution in cycles, the counter width in bits, 
+        /// the number of entries and the entries (sample position, cycles) as big endian uint32_t values
+        void writeTo(Stream &out){
+            uint32_t frequency = CYCLE_COUNT_FREQUENCY;
+            uint32_t resolution = CYCLE_COUNT_RESOLUTION;
+            uint32_t bits = __builtin_popcountl(CYCLE_COUNT_MASK);
+            uint32_t header[5] = {htonl((uint32_t)interval_count), htonl(frequency), htonl(resolution), htonl(bits), htonl((uint32_t)count)};
+            out.write((const uint8_t*)header, sizeof(header));
+            for (size_t j=0; j<count; j++){
+                uint32_t values[2] = {htonl(entries[j].sample_pos), htonl(entries[j].cycles)};
+                out.write((const uint8_t*)values, sizeof(values));
+            }
+            out.flush();
+        }
+
+    protected:
+        Entry *entries = nullptr;
+        size_t max_count = 0;
+        size_t count = 0;
+        uint16_t interval_count = 0;
+};
+
+/**
+ * @brief Optional integrity check of the dump: we calculate the CRC32 of each block of the dumped data, so that the host 
+ * can detect transmission errors and request the affected blocks again from the retained buffer instead of repeating 
+ * the whole capture.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class BlockChecksums {
+    public:
+        BlockChecksums(uint16_t blockSize, size_t maxCount){
+            block_size = blockSize;
+            crcs = new uint32_t[maxCount];
+            max_count = crcs==nullptr ? 0 : maxCount;
+        }
+
+        ~BlockChecksums(){
+            if (crcs!=nullptr){
+                delete[] crcs;
+            }
+        }
+
+        /// adds the checksum of the next block
+        void add(uint32_t crc){
+            if (count < max_count){
+                crcs[count++] = crc;
+            }
+        }
+
+        /// removes all entries
+        void clear() {
+            count = 0;
+        }
+
+        /// Provides the number of entries in a block
+        uint16_t blockSize() {
+            return block_size;
+        }
+
+        /// Provides the number of recorded checksums
+        size_t size() {
+            return count;
+        }
+
+        /// Provides the checksum of the indicated block
+        uint32_t operator[](size_t idx){
+            return crcs[idx];
+        }
+
+        /// writes the indicated block of the data which is retained in the buffer and optionally records its checksum: 
+        /// returns the number of written entries
+        size_t writeBlock(size_t blockIdx, bool recordChecksum=false) {
+            size_t offset = blockIdx * block_size;
+            size_t open = block_size;
+            uint32_t crc = 0;
+            const PinBitArray *block;
+            size_t len;
+            // the block might wrap around the end of the buffer
+            while(open > 0 && (len = buffer_ptr->peekBlock(offset, block, open)) > 0){
+                crc = CRC32::calculate(block, len * sizeof(PinBitArray), crc);
+                write((PinBitArray *)block, len);
+                offset += len;
+                open -= len;
+            }
+            size_t result = block_size - open;
+            if (recordChecksum && result > 0){
+                add(crc);
+            }
+            return result;
+        }
+
+        /// writes the block size in entries, the number of blocks and the CRC32 of each block as big endian uint32_t values
+        void writeTo(Stream &out){
+            uint32_t header[2] = {htonl((uint32_t)block_size), htonl((uint32_t)count)};
+            out.write((const uint8_t*)header, sizeof(header));
+            for (size_t j=0; j<count; j++){
+                uint32_t crc = htonl(crcs[j]);
+                out.write((const uint8_t*)&crc, sizeof(crc));
+            }
+            out.flush();
+        }
+
+    protected:
+        uint32_t *crcs = nullptr;
+        size_t count = 0;
+        size_t max_count = 0;
+        uint16_t block_size = 0;
+};
+
+/**
+ * @brief Optional dump protocol for lossy or flow controlled links: the data is sent in numbered frames of blockSize 
+ * entries and at most window frames can be unacknowledged. Each frame consists of the sync byte FRAMED_DUMP_SYNC, the 
+ * sequence number (uint32_t), the number of entries (uint16_t), the entries and the CRC32 of the preceding frame 
+ * content (uint32_t). The last frame is empty. The host acknowledges all frames up to a sequence number with 
+ * SUMP_VENDOR_ACK and requests an individual frame again with SUMP_VENDOR_NAK: the sequence number is the uint32_t 
+ * argument of the command. All numbers of the protocol are big endian. If there is no acknowledgement within 
+ * FRAMED_DUMP_TIMEOUT_MS we send the oldest unacknowledged frame again. Any other command aborts the dump and is 
+ * left in the stream for processCommand(). The data is kept in the buffer, so that any frame can be resent w/o copy.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FramedDump {
+    public:
+        /// Activates the protocol with the indicated frame size in entries and window: a block size of 0 deactivates it
+        void setActive(uint16_t blockSize, uint8_t window=FRAMED_DUMP_WINDOW){
+            block_size = blockSize;
+            window_size = window > 0 ? window : 1;
+        }
+
+        /// Checks if the host has activated the protocol
+        bool isActive() {
+            return block_size > 0;
+        }
+
+        /// Provides the number of entries in a frame
+        uint16_t blockSize() {
+            return block_size;
+        }
+
+        /// Provides the max number of unacknowledged frames
+        uint8_t window() {
+            return window_size;
+        }
+
+        /// Sends the available data in frames: returns false if the dump was aborted or the host stopped to respond
+        bool writeTo(Stream &out){
+            uint32_t frames = (buffer_ptr->available() + block_size - 1) / block_size;
+            // the empty end frame has the sequence number frames
+            uint32_t base = 0;
+            uint32_t next = 0;
+            int retries = 0;
+            unsigned long last_progress = millis();
+            while (base <= frames){
+                while (next <= frames && next < base + window_size){
+                    writeFrame(out, next++);
+                }
+                out.flush();
+                if (out.available() > 0){
+                    int cmd = out.peek();
+                    if (cmd != SUMP_VENDOR_ACK && cmd != SUMP_VENDOR_NAK){
+                        // the command is processed by processCommand()
+                        log("framed dump aborted by command %d", cmd);
+                        return false;
+                    }
+                    out.read();
+                    uint8_t arg[4];
+                    if (out.readBytes(arg, 4) != 4){
+                        // we lost the command boundaries: so we drop the rest of the input
+                        log("framed dump aborted by an incomplete command");
+                        while (out.available() > 0) out.read();
+                        return false;
+                    }
+                    uint32_t seq = (uint32_t)arg[0] << 24 | (uint32_t)arg[1] << 16 | (uint32_t)arg[2] << 8 | arg[3];
+                    if (seq >= base && seq < next){
+                        if (cmd == SUMP_VENDOR_ACK){
+                            base = seq + 1;
+                        } else {
+                            writeFrame(out, seq);
+                        }
+                        retries = 0;
+                        last_progress = millis();
+                    }
+                } else if (millis() - last_progress > FRAMED_DUMP_TIMEOUT_MS){
+                    if (++retries > FRAMED_DUMP_RETRIES){
+                        log("framed dump: no acknowledgement");
+                        return false;
+                    }
+                    writeFrame(out, base);
+                    last_progress = millis();
+                }
+            }
+            return true;
+        }
+
+    protected:
+        uint16_t block_size = 0;
+        uint8_t window_size = FRAMED_DUMP_WINDOW;
+
+        /// writes the frame with the indicated sequence number from the data retained in the buffer
+        void writeFrame(Stream &out, uint32_t seq){
+            size_t offset = (size_t) seq * block_size;
+            size_t available = buffer_ptr->available();
+            size_t count = offset >= available ? 0 : available - offset;
+            if (count > block_size) count = block_size;
+            uint8_t header[7] = {FRAMED_DUMP_SYNC, (uint8_t)(seq >> 24), (uint8_t)(seq >> 16), (uint8_t)(seq >> 8), (uint8_t)seq, 
+                (uint8_t)(count >> 8), (uint8_t)count};
+            out.write(header, sizeof(header));
+            uint32_t crc = CRC32::calculate(header + 1, sizeof(header) - 1);
+            const PinBitArray *block;
+            size_t len;
+            // the frame might wrap around the end of the buffer
+            while(count > 0 && (len = buffer_ptr->peekBlock(offset, block, count)) > 0){
+                crc = CRC32::calculate(block, len * sizeof(PinBitArray), crc);
+                size_t open = len * sizeof(PinBitArray);
+                while (open > 0){
+                    open -= out.write((const uint8_t*)block + (len * sizeof(PinBitArray) - open), open);
+                }
+                offset += len;
+                count -= len;
+            }
+            crc = htonl(crc);
+            out.write((const uint8_t*)&crc, sizeof(crc));
+        }
+};
+
 /**
  * @brief Common State information for the Logic Analyzer - provides event handling on State change.
  * @author Phil Schatzmann
@@ -253,6 +775,14 @@ class LogicAnalyzerState {
         friend class AbstractCapture;
         friend class LogicAnalyzer;
         friend class Capture;
+        friend class DualCoreCapture;
+        friend class AVRBurstCapture;
+        friend class CaptureSelector;
+        friend class DualTimebaseCapture;
+        friend class EventLoggerCapture;
+        friend class HistogramCapture;
+        friend class PulseWidthCapture;
+        friend class SetupHoldCapture;
 
         /// Defines the actual status
         void setStatus(Status status){
@@ -268,6 +798,8 @@ class LogicAnalyzerState {
     protected:
         volatile Status status_value;
         bool is_continuous_capture = false; // => continous capture
+        bool is_demux = false; // => 2 samples of 16 channels per entry
+        uint32_t divider = 0;
         uint32_t max_capture_size = 1000;
         int trigger_pos = -1;
         int read_count = 0;
@@ -290,6 +822,33 @@ class LogicAnalyzerState {
 
 
 
+/**
+ * @brief Decisions for the capturing which are updated whenever the configuration is changing, so that 
+ * ARM just needs to execute them.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct CapturePlan {
+    bool is_valid = false;
+    CaptureLoop loop = LOOP_UNSUPPORTED;
+    unsigned long delay_time_us = 0; // pacing between samples
+    long keep = 0; // number of pre-trigger entries: negative to ignore the first entries
+    float clock_divider = 1.0; // used by hardware based implementations
+};
+
+/**
+ * @brief Envelope of the supported requests of a capture implementation: this is used by the CaptureSelector 
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct CaptureCapabilities {
+    uint64_t max_frequency = 0; // max supported entries per second
+    bool is_trigger_supported = false;
+    bool is_continuous_supported = false;
+    bool is_demux_supported = false;
+    bool is_exact_timing = false; // sampling is paced by hardware
+};
+
 /**
  * @brief Abstract Class for Capturing Logic. Create your own subclass if you want to implement your own
  * optimized capturing logic. Otherwise just use the provided Capture class.
@@ -299,6 +858,7 @@ class LogicAnalyzerState {
 class AbstractCapture {
     public:
          friend class LogicAnalyzer;
+         friend class CaptureSelector;
 
         /// Default Constructor
         AbstractCapture(){
@@ -329,14 +889,63 @@ class AbstractCapture {
         /// Used to masure the speed - capture into memory w/o dump!
         virtual void captureAll() = 0;
 
+        /// Starts the capturing w/o blocking. Returns true if the processing needs to be continued with captureStep(). 
+        /// The default implementation just captures in one go.
+        virtual bool captureStart() {
+            capture();
+            return false;
+        }
+
+        /// Continues a capturing started with captureStart() by processing max budget samples. Returns false when done.
+        virtual bool captureStep(size_t budget) {
+            return false;
+        }
+
+        /// Updates the capture plan after the indicated change of the configuration
+        virtual void updatePlan(Event event) {
+        }
+
+        /// Processes capture specific (vendor) commands: returns true if the command was handled
+        virtual bool processCommand(int cmd) {
+            return false;
+        }
+
+        /// Provides the supported requests: by default we do not know anything
+        virtual CaptureCapabilities capabilities() {
+            CaptureCapabilities result;
+            return result;
+        }
+
+        /// Provides the actual capture plan
+        virtual CapturePlan &plan() {
+            return capture_plan;
+        }
+
+        /// Replaces the capture plan e.g. with the plan that was stored in a profile
+        virtual void setPlan(const CapturePlan &plan) {
+            capture_plan = plan;
+        }
+
 
     protected:
         LogicAnalyzer *logic_analyzer_ptr = nullptr;
+        CapturePlan capture_plan;
 
         virtual void setLogicAnalyzer(LogicAnalyzer &la){
             logic_analyzer_ptr = &la;
         }
 
+        /// Checks the command stream for a pending command w/o removing it, so that it is processed by processCommand() 
+        /// afterwards: Pulseview sends the whole configuration before the ARM, so any command stops the capturing
+        bool isAbortRequested() {
+            if (stream_ptr->available()>0){
+                log("abort requested by command %d", stream_ptr->peek());
+                setStatus(STOPPED);
+                return true;
+            }
+            return false;
+        }
+
 };
 
 /**
@@ -355,35 +964,200 @@ class Capture : public AbstractCapture {
         /// starts the capturing of the data
         virtual void capture(){
             log("capture");
-            // no capture if request is well above max rate
-            if (la_state.frequecy_value > max_frequecy_value + (max_frequecy_value/2)){
-                setStatus(STOPPED);
-                // Send some dummy data to stop pulseview
-                write(0);
-                log("The frequency %u is not supported!", la_state.frequecy_value );
+            if (!isSupportedFrequency()){
                 return;
             }
-
-            // if frequecy_value >= max_frequecy_value -> capture at max speed
-            capture(la_state.frequecy_value >= max_frequecy_threshold); 
+            bool is_continuous = capture_plan.loop == LOOP_CONTINUOUS || capture_plan.loop == LOOP_CONTINUOUS_MAX_SPEED;
+            if (is_triggered_streaming && !is_continuous){
+                captureStreaming(capture_plan);
+            } else {
+                capture(capture_plan); 
+            }
             log("capture-end");
         }
 
+        /// Switch the triggered streaming on/off: each triggered window is sent with a header as soon as it is complete
+        /// and we re-arm immediately until the capturing is stopped with any command (e.g. a RESET).
+        void setTriggeredStreaming(bool active) {
+            is_triggered_streaming = active;
+        }
+
+        /// checks if the triggered streaming is active
+        bool isTriggeredStreaming() {
+            return is_triggered_streaming;
+        }
+
+        /// Software capturing supports all requests up to the accepted max frequency
+        virtual CaptureCapabilities capabilities() {
+            CaptureCapabilities result;
+            result.max_frequency = max_frequecy_value + (max_frequecy_value/2);
+            result.is_trigger_supported = true;
+            result.is_continuous_supported = true;
+            result.is_demux_supported = LA_IS_DEMUX_SUPPORTED;
+            return result;
+        }
+
+        /// Updates the affected parts of the capture plan
+        virtual void updatePlan(Event event) {
+            if (!capture_plan.is_valid){
+                planAll();
+                return;
+            }
+            switch(event){
+                case CAPTURE_FREQUNCY:
+                case FLAGS:
+                    planLoop();
+                    break;
+                case READ_DLEAY_COUNT:
+                    planKeep();
+                    break;
+                case PROFILE:
+                    planAll();
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        /// starts the capturing w/o blocking: the processing is done in captureStep()
+        virtual bool captureStart() {
+            log("captureStart");
+            if (!isSupportedFrequency()){
+                return false;
+            }
+            // in demux mode each entry consists of 2 samples
+            delay_time_us = isDemuxLoop(capture_plan.loop) ? 2 * capture_plan.delay_time_us : capture_plan.delay_time_us;
+            next_sample_us = micros();
+            if (la_state.trigger_mask) {
+                log("waiting for trigger");
+                phase = WAITING_FOR_TRIGGER;
+            } else {
+                triggered();
+            }
+            return true;
+        }
+
+        /// processes max budget samples of the actual phase: returns false when the capturing has ended
+        virtual bool captureStep(size_t budget) {
+            if (la_state.status_value == STOPPED){
+                phase = IDLE;
+            }
+            switch(phase){
+                case WAITING_FOR_TRIGGER:
+                    for (size_t j=0; j<budget; j++){
+                        if (((la_state.trigger_values ^ captureSample()) & la_state.trigger_mask)==0){
+                            triggered();
+                            break;
+                        }
+                    }
+                    break;
+
+                case SAMPLING:
+                    for (size_t j=0; j<budget; j++){
+                        if (!la_state.is_continuous_capture && buffer_ptr->available() >= la_state.read_count){
+                            decode();
+                            phase = DUMPING;
+                            break;
+                        }
+                        // yield until the next sample is due
+                        if (delay_time_us>0){
+                            if ((long)(micros() - next_sample_us) < 0) break;
+                            next_sample_us += delay_time_us;
+                        }
+                        if (la_state.is_continuous_capture){
+                            if (decoders_ptr!=nullptr){
+                                captureSampleDecodedContinuous();
+                            } else {
+                                captureSampleFastContinuous();
+                            }
+                        } else if (la_state.is_demux){
+                            captureSampleDemux();
+                        } else {
+                            captureSampleFast();
+                        }
+                    }
+                    if (la_state.is_continuous_capture && decoders_ptr!=nullptr){
+                        decodeContinuous();
+                    }
+                    break;
+
+                case DUMPING: {
+                        // the framed dump and the checksums are using the whole buffer: so we send it in one go
+                        if (isDumpProtected()){
+                            writeData();
+                            log("capture-done");
+                            phase = IDLE;
+                            setStatus(STOPPED);
+                            break;
+                        }
+                        PinBitArray *block;
+                        size_t len = buffer_ptr->readBlock(block, budget);
+                        if (len>0){
+                            write(block, len);
+                        } else {
+                            stream_ptr->flush();
+                            log("capture-done");
+                            phase = IDLE;
+                            setStatus(STOPPED);
+                        }
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+            return phase != IDLE;
+        }
+
         /// Generic Capturing of requested number of examples into the buffer
         void captureAll() {
             log("captureAll %ld entries", la_state.read_count);
             unsigned long delay_time_us = la_state.delay_time_us;
-            while(la_state.status_value == TRIGGERED && buffer_ptr->available() < la_state.read_count ){
-                captureSampleFast();   
-                delayMicroseconds(delay_time_us);
+            size_t n;
+            while((n = nextBlockSize()) > 0){
+                for (size_t j=0; j<n; j++){
+                    captureSampleFast();   
+                    PROBE_START(PROBE_DELAY);
+                    delayMicroseconds(delay_time_us);
+                    PROBE_END(PROBE_DELAY);
+                }
             }
         }
 
         /// Capturing of requested number of examples into the buffer at maximum speed 
         void captureAllMaxSpeed() {
             log("captureAllMaxSpeed %ld entries",la_state.read_count);
-            while(la_state.status_value == TRIGGERED && buffer_ptr->available() < la_state.read_count ){
-                captureSampleFast();
+            size_t n;
+            while((n = nextBlockSize()) > 0){
+                for (size_t j=0; j<n; j++){
+                    captureSampleFast();
+                }
+            }
+        }
+
+        /// Capturing of requested number of entries with 2 samples each at the requested speed
+        void captureAllDemux() {
+            log("captureAllDemux %ld entries", la_state.read_count);
+            unsigned long delay_time_us = la_state.delay_time_us;
+            size_t n;
+            while((n = nextBlockSize()) > 0){
+                for (size_t j=0; j<n; j++){
+                    PinBitArray first = pin_reader_ptr->readAll();
+                    delayMicroseconds(delay_time_us);
+                    buffer_ptr->write(demux(first, pin_reader_ptr->readAll()));
+                    delayMicroseconds(delay_time_us);
+                }
+            }
+        }
+
+        /// Capturing of requested number of entries with 2 samples each at maximum speed 
+        void captureAllDemuxMaxSpeed() {
+            log("captureAllDemuxMaxSpeed %ld entries",la_state.read_count);
+            size_t n;
+            while((n = nextBlockSize()) > 0){
+                for (size_t j=0; j<n; j++){
+                    captureSampleDemux();
+                }
             }
         }
 
@@ -391,28 +1165,85 @@ class Capture : public AbstractCapture {
         void captureAllContinous() {
             log("captureAllContinous");
             unsigned long delay_time_us = la_state.delay_time_us;
-            while(la_state.status_value == TRIGGERED){
-                captureSampleFastContinuous();   
-                delayMicroseconds(delay_time_us);
+            bool is_decoding = decoders_ptr!=nullptr;
+            size_t n;
+            while((n = nextBlockSize()) > 0){
+                for (size_t j=0; j<n; j++){
+                    if (is_decoding){
+                        captureSampleDecodedContinuous();
+                    } else {
+                        captureSampleFastContinuous();   
+                    }
+                    PROBE_START(PROBE_DELAY);
+                    delayMicroseconds(delay_time_us);
+                    PROBE_END(PROBE_DELAY);
+                }
+                if (is_decoding) decodeContinuous();
             }
+            stream_ptr->flush();
         }
 
         /// Continuous capturing at max speed
         void captureAllContinousMaxSpeed() {
             log("captureAllContinousMaxSpeed");
-            while(la_state.status_value == TRIGGERED){
-                captureSampleFastContinuous();   
+            size_t n;
+            while((n = nextBlockSize()) > 0){
+                // the decoders are evaluating the samples after each block
+                if (decoders_ptr!=nullptr){
+                    for (size_t j=0; j<n; j++){
+                        captureSampleDecodedContinuous();   
+                    }
+                    decodeContinuous();
+                } else {
+                    for (size_t j=0; j<n; j++){
+                        captureSampleFastContinuous();   
+                    }
+                }
             }
+            stream_ptr->flush();
         }
 
         /// captures one singe entry for all pins and writes it to the buffer
         void captureSampleFast() {
-            buffer_ptr->write(pin_reader_ptr->readAll());            
+            PROBE_START(PROBE_READ);
+            PinBitArray value = pin_reader_ptr->readAll();
+            PROBE_END(PROBE_READ);
+            buffer_ptr->write(value);            
+        }
+
+        /// captures two subsequent samples and writes them as one entry to the buffer
+        void captureSampleDemux() {
+            PROBE_START(PROBE_READ);
+            PinBitArray first = pin_reader_ptr->readAll();
+            PinBitArray second = pin_reader_ptr->readAll();
+            PROBE_END(PROBE_READ);
+            buffer_ptr->write(demux(first, second));
+        }
+
+        /// OLS demux layout: channels 0-15 of the first sample in the lower and of the second sample in the upper half
+        static PinBitArray demux(PinBitArray first, PinBitArray second) {
+            return (PinBitArray)(((uint32_t)first & 0xFFFFUL) | ((uint32_t)second << 16));
         }
 
         /// captures one singe entry for all pins and writes it to output stream
         void captureSampleFastContinuous() {
-            write(pin_reader_ptr->readAll());            
+            PROBE_START(PROBE_READ);
+            PinBitArray value = pin_reader_ptr->readAll();
+            PROBE_END(PROBE_READ);
+            write(value);            
+        }
+
+        /// captures one single entry for all pins, writes it to the output stream and keeps it in the buffer for the 
+        /// decoders
+        void captureSampleDecodedContinuous() {
+            PROBE_START(PROBE_READ);
+            PinBitArray value = pin_reader_ptr->readAll();
+            PROBE_END(PROBE_READ);
+            write(value);
+            buffer_ptr->write(value);
+            if (buffer_ptr->available() >= buffer_ptr->size()){
+                decodeContinuous();
+            }
         }
 
         /// captures one single entry for all pins and provides the result - used by the trigger
@@ -433,21 +1264,241 @@ class Capture : public AbstractCapture {
     protected:
         uint64_t max_frequecy_value;  // in hz
         uint64_t max_frequecy_threshold;  // in hz
+        CapturePhase phase = IDLE;
+        bool is_triggered_streaming = false;
+        unsigned long delay_time_us = 0;
+        unsigned long next_sample_us = 0;
+        uint32_t high_us = 0;
+        uint32_t last_us = 0;
+
+        /// micros() extended to 64 bits: this needs to be called at least once per overflow of micros()
+        uint64_t timeUs() {
+            uint32_t now = micros();
+            if (now < last_us){
+                high_us++;
+            }
+            last_us = now;
+            return (static_cast<uint64_t>(high_us) << 32) | now;
+        }
 
-        /// starts the capturing of the data
-        void capture(bool is_max_speed) {
-            log("capture is_max_speed: %s", is_max_speed ? "true":"false");
+        /// executes the capture plan
+        void capture(const CapturePlan &plan) {
+            log("capture loop: %d", plan.loop);
             // waiting for trigger
             if (la_state.trigger_mask) {
                 log("waiting for trigger");
-                while ((la_state.trigger_values ^ captureSample()) & la_state.trigger_mask)
-                    ;
+                TRACE_BEGIN("trigger wait");
+                bool is_triggered = waitForTrigger();
+                TRACE_END("trigger wait");
+                if (!is_triggered){
+                    log("capture aborted");
+                    return;
+                }
             } 
+            triggered();
+
+            // Start Capture
+            TRACE_BEGIN("capture");
+            captureLoop(plan.loop);
+            TRACE_END("capture");
+            // the continuous data has already been sent
+            if (plan.loop != LOOP_CONTINUOUS && plan.loop != LOOP_CONTINUOUS_MAX_SPEED){
+                dumpResult();
+            }
+            phase = IDLE;
+        }
+
+        /// Repeats the capturing of triggered windows with their pre-trigger history: each window is sent with a header 
+        /// (magic, sequence number, high and low word of the 64 bit trigger time in us and number of entries as big 
+        /// endian uint32_t) 
+        void captureStreaming(const CapturePlan &plan) {
+            log("capture streaming - loop: %d", plan.loop);
+            uint32_t sequence = 0;
+            while(true){
+                buffer_ptr->clear();
+                if (la_state.trigger_mask) {
+                    // the pre-trigger history would not be packed in demux mode
+                    bool is_triggered = isDemuxLoop(plan.loop) ? waitForTrigger() : waitForTriggerWithHistory(plan.delay_time_us);
+                    if (!is_triggered) break;
+                }
+                uint64_t timestamp_us = timeUs();
+                triggered();
+                TRACE_BEGIN("capture");
+                captureLoop(plan.loop);
+                TRACE_END("capture");
+                if (la_state.status_value != TRIGGERED) break;
+                writeWindowHeader(sequence++, timestamp_us, buffer_ptr->available());
+                dumpData();
+                // re-arm
+                la_state.setStatus(ARMED);
+            }
+            log("capture streaming ended after %u windows", sequence);
+            buffer_ptr->clear();
+            phase = IDLE;
+        }
+
+        /// writes the header of a window in the triggered streaming mode
+        void writeWindowHeader(uint32_t sequence, uint64_t timestampUs, uint32_t count) {
+            uint32_t header[5] = {htonl(STREAM_WINDOW_MAGIC), htonl(sequence), htonl((uint32_t)(timestampUs >> 32)), 
+                htonl((uint32_t) timestampUs), htonl(count)};
+            stream_ptr->write((const uint8_t*)header, sizeof(header));
+        }
+
+        /// executes the selected capture loop
+        void captureLoop(CaptureLoop loop) {
+            switch(loop){
+                case LOOP_MAX_SPEED:
+                    captureAllMaxSpeed();
+                    break;
+                case LOOP_DEMUX:
+                    captureAllDemux();
+                    break;
+                case LOOP_DEMUX_MAX_SPEED:
+                    captureAllDemuxMaxSpeed();
+                    break;
+                case LOOP_CONTINUOUS:
+                    captureAllContinous();
+                    break;
+                case LOOP_CONTINUOUS_MAX_SPEED:
+                    captureAllContinousMaxSpeed();
+                    break;
+                default:
+                    captureAll();
+                    break;
+            }
+        }
+
+        /// rebuilds the complete capture plan
+        void planAll() {
+            planLoop();
+            planKeep();
+            capture_plan.is_valid = true;
+        }
+
+        /// selects the capture loop and the pacing
+        void planLoop() {
+            uint64_t frequency = entryFrequency();
+            // no capture if request is well above max rate
+            if (frequency > max_frequecy_value + (max_frequecy_value/2)){
+                capture_plan.loop = LOOP_UNSUPPORTED;
+                return;
+            }
+            // if frequecy_value >= max_frequecy_threshold -> capture at max speed
+            bool is_max_speed = frequency >= max_frequecy_threshold;
+            capture_plan.delay_time_us = is_max_speed ? 0 : la_state.delay_time_us;
+            if (la_state.is_continuous_capture){
+                capture_plan.loop = is_max_speed ? LOOP_CONTINUOUS_MAX_SPEED : LOOP_CONTINUOUS;
+            } else if (la_state.is_demux){
+                capture_plan.loop = is_max_speed ? LOOP_DEMUX_MAX_SPEED : LOOP_DEMUX;
+            } else {
+                capture_plan.loop = is_max_speed ? LOOP_MAX_SPEED : LOOP_PACED;
+            }
+        }
+
+        /// Provides the frequency of the entries in the buffer: in demux mode each entry contains 2 samples
+        uint64_t entryFrequency() {
+            return la_state.is_demux && !la_state.is_continuous_capture ? la_state.frequecy_value / 2 : la_state.frequecy_value;
+        }
+
+        /// checks if the loop is packing 2 samples into each entry
+        static bool isDemuxLoop(CaptureLoop loop) {
+            return loop == LOOP_DEMUX || loop == LOOP_DEMUX_MAX_SPEED;
+        }
+
+        /// determines the number of pre-trigger entries based on delayCount & readCount
+        void planKeep() {
+            capture_plan.keep = la_state.read_count - la_state.delay_count;
+        }
+
+        /// dumps the captured data - an aborted capture is discarded because Pulseview is not waiting for it any more
+        void dumpResult() {
+            if (la_state.status_value != TRIGGERED){
+                log("capture aborted");
+                buffer_ptr->clear();
+                return;
+            }
+            dumpData();
+            log("capture-done: %lu",buffer_ptr->available());
+            setStatus(STOPPED);
+        }
+
+        /// waits for the trigger condition: returns false if the capture has been aborted
+        bool waitForTrigger() {
+            while(true){
+                for (int j=0; j<ABORT_CHECK_INTERVAL; j++){
+                    if (((la_state.trigger_values ^ captureSample()) & la_state.trigger_mask)==0){
+                        return true;
+                    }
+                }
+                // keeps the 64 bit time current while we are waiting for a rare trigger
+                timeUs();
+                if (la_state.status_value == STOPPED || isAbortRequested()){
+                    return false;
+                }
+            }
+        }
+
+        /// waits for the trigger condition and keeps all samples as pre-trigger history in the buffer: returns false if the capture has been aborted
+        bool waitForTriggerWithHistory(unsigned long delayUs) {
+            PinReader &reader = *pin_reader_ptr;
+            while(true){
+                for (int j=0; j<ABORT_CHECK_INTERVAL; j++){
+                    PinBitArray value = reader.readAll();
+                    buffer_ptr->write(value);
+                    if (((la_state.trigger_values ^ value) & la_state.trigger_mask)==0){
+                        return true;
+                    }
+                    if (delayUs>0) delayMicroseconds(delayUs);
+                }
+                timeUs();
+                if (la_state.status_value == STOPPED || isAbortRequested()){
+                    return false;
+                }
+            }
+        }
+
+        /// Provides the number of samples which can be captured before we check again for the end or an abort: 0 if we are done
+        size_t nextBlockSize() {
+            PROBE_START(PROBE_LOOP_CHECK);
+            size_t result = ABORT_CHECK_INTERVAL;
+            if (la_state.status_value != TRIGGERED || isAbortRequested()){
+                result = 0;
+            } else if (!la_state.is_continuous_capture){
+                size_t available = buffer_ptr->available();
+                size_t open = available >= la_state.read_count ? 0 : la_state.read_count - available;
+                // the blocks are aligned with the timestamps, so that we need only one counter read per interval
+                if (timestamps_ptr!=nullptr){
+                    timestamps_ptr->record(available);
+                    result = timestamps_ptr->interval();
+                }
+                if (open < result) result = open;
+            }
+            PROBE_END(PROBE_LOOP_CHECK);
+            return result;
+        }
+
+        /// checks if the requested frequency can be captured - if not we stop pulseview
+        bool isSupportedFrequency() {
+            if (!capture_plan.is_valid){
+                planAll();
+            }
+            if (capture_plan.loop == LOOP_UNSUPPORTED){
+                setStatus(STOPPED);
+                // Send some dummy data to stop pulseview
+                write(0);
+                log("The frequency %u is not supported!", la_state.frequecy_value );
+                return false;
+            }
+            return true;
+        }
+
+        /// the trigger condition was met: we prepare the buffer for the sampling 
+        void triggered() {
             la_state.setStatus(TRIGGERED);
             log("triggered");
 
             // remove unnecessary entries from buffer based on delayCount & readCount
-            long keep = la_state.read_count - la_state.delay_count;   
+            long keep = capture_plan.keep;
             if (keep > 0 && buffer_ptr->available()>keep)  {
                 log("keeping last %ld entries",keep);
                 buffer_ptr->clear(buffer_ptr->available() - keep);
@@ -458,27 +1509,12 @@ class Capture : public AbstractCapture {
                 log("starting with clean buffer");
                 buffer_ptr->clear();
             } 
-
-            // Start Capture
-            if (is_max_speed){
-                if (la_state.is_continuous_capture){
-                    captureAllContinousMaxSpeed();
-                } else {
-                    captureAllMaxSpeed();
-                    dumpData();
-                    log("capture-done: %lu",buffer_ptr->available());
-                    setStatus(STOPPED);
-                }
-            } else { 
-                if (la_state.is_continuous_capture){
-                    captureAllContinous();
-                } else {
-                    captureAll();
-                    dumpData();
-                    log("capture-done: %lu",buffer_ptr->available());
-                    setStatus(STOPPED);
-                }
+            // in continuous mode the buffer only keeps the samples for the decoders
+            if (la_state.is_continuous_capture && decoders_ptr!=nullptr){
+                buffer_ptr->clear();
+                decoders_ptr->reset();
             }
+            phase = SAMPLING;
         }
 
         /// Provides access to the SUMP command stream
@@ -486,23 +1522,100 @@ class Capture : public AbstractCapture {
             return *stream_ptr;
         }
 
-       
+        /// runs the registered decoders over the captured data w/o removing it from the buffer
+        void decode() {
+            // in demux mode the entries contain 2 samples
+            if (decoders_ptr==nullptr || la_state.is_demux) return;
+            TRACE_BEGIN("decode");
+            decoders_ptr->reset();
+            const PinBitArray *block;
+            size_t len;
+            size_t offset = 0;
+            while((len = buffer_ptr->peekBlock(offset, block, DUMP_RECORD_SIZE)) > 0){
+                decoders_ptr->decode(block, len);
+                offset += len;
+            }
+            TRACE_END("decode");
+        }
+
+        /// passes the samples which have been kept in continuous mode to the decoders and removes them from the buffer
+        void decodeContinuous() {
+            PinBitArray *block;
+            size_t len;
+            while((len = buffer_ptr->readBlock(block, DUMP_RECORD_SIZE)) > 0){
+                decoders_ptr->decode(block, len);
+            }
+        }
+
         /// dumps the caputred data to the recording device
         void dumpData() {
             log("dumpData: %lu",buffer_ptr->available());
-            // buffered write 
-            uint32_t tmp[DUMP_RECORD_SIZE];
+            decode();
+            writeData();
+            log("dumpData-end");
+        }
+
+        /// checks if the data is sent with the framed dump or with checksums
+        bool isDumpProtected() {
+            return (framed_dump_ptr!=nullptr && framed_dump_ptr->isActive()) || checksums_ptr!=nullptr;
+        }
+
+        /// writes the (already decoded) data with the active dump protocol 
+        void writeData() {
+            TRACE_BEGIN("dump");
             stream_ptr->setTimeout(10000);
-            while(buffer_ptr->available()){
-                size_t len = buffer_ptr->readBuffer(tmp, DUMP_RECORD_SIZE);
-                write(tmp, len);
+            if (framed_dump_ptr!=nullptr && framed_dump_ptr->isActive()){
+                framed_dump_ptr->writeTo(*stream_ptr);
+            } else if (checksums_ptr!=nullptr){
+                dumpDataWithChecksums();
+            } else {
+                // write the blocks directly from the buffer 
+                PinBitArray *block;
+                size_t len;
+                while((len = buffer_ptr->readBlock(block, DUMP_RECORD_SIZE)) > 0){
+                    TRACE_BEGIN("dump block");
+                    write(block, len);
+                    TRACE_END("dump block");
+                }
             }
             // flush final records - for backward compatibility 
+            TRACE_BEGIN("flush");
             stream_ptr->flush();
-            log("dumpData-end");
+            TRACE_END("flush");
+            TRACE_END("dump");
+        }
+
+        /// dumps the captured data in blocks of the checksum block size and records the CRC32 of each block: the data is 
+        /// kept in the buffer, so that individual blocks can be sent again
+        void dumpDataWithChecksums() {
+            checksums_ptr->clear();
+            // the last block might be shorter
+            size_t block_idx = 0;
+            while(checksums_ptr->writeBlock(block_idx++, true) == checksums_ptr->blockSize());
         }
 };
 
+/**
+ * @brief Snapshot of the capture configuration which is stored in a profile slot, so that it can
+ * be restored and armed with a single command. It also contains the derived values and the capture plan, 
+ * so that they do not need to be recalculated.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct CaptureProfile {
+    bool is_valid = false;
+    bool is_continuous_capture = false;
+    bool is_demux = false;
+    uint32_t divider = 0;
+    int read_count = 0;
+    int delay_count = 0;
+    uint64_t frequecy_value = 0;
+    uint64_t delay_time_us = 0;
+    PinBitArray trigger_mask = 0;
+    PinBitArray trigger_values = 0;
+    CapturePlan plan;
+};
+
 /**
  * @brief Main Logic Analyzer API using the SUMP Protocol.
  * When you try to connect to the Logic Analzyer - SUMP calls the following requests
@@ -530,6 +1643,22 @@ class LogicAnalyzer {
                 delete pin_reader_ptr;
                 pin_reader_ptr = nullptr;
             }
+            if (timestamps_ptr!=nullptr){
+                delete timestamps_ptr;
+                timestamps_ptr = nullptr;
+            }
+            if (checksums_ptr!=nullptr){
+                delete checksums_ptr;
+                checksums_ptr = nullptr;
+            }
+            if (framed_dump_ptr!=nullptr){
+                delete framed_dump_ptr;
+                framed_dump_ptr = nullptr;
+            }
+            if (metadata!=nullptr){
+                delete[] metadata;
+                metadata = nullptr;
+            }
         }
 
         /**
@@ -554,6 +1683,7 @@ class LogicAnalyzer {
             la_state.delay_count = maxCaptureSize;
             la_state.pin_start = pinStart;
             la_state.pin_numbers = numberOfPins;
+            metadata_len = 0;
 
             // set initial status
             setStatus(STOPPED);
@@ -569,6 +1699,7 @@ class LogicAnalyzer {
             // assign state to capture 
             if (capture!=nullptr) {
                 capture->setLogicAnalyzer(*this);
+                capture->updatePlan(PROFILE);
             }
 
             // by default the pins are in read mode - so it is usually not really necesarry to set the mode to input
@@ -619,6 +1750,11 @@ class LogicAnalyzer {
                 log("processCommand %d", cmd);
                 processCommand(cmd);
             }
+            // continue the cooperative capturing
+            if (is_capture_active){
+                is_capture_active = capture_ptr->captureStep(step_budget);
+                if (!is_capture_active) restoreTimebase();
+            }
         }
 
         /// provides the trigger values
@@ -653,6 +1789,7 @@ class LogicAnalyzer {
         /// defines the read count
         void setReadCount(int count){
             la_state.read_count = count;
+            raiseEvent(READ_DLEAY_COUNT);
         }
 
         /// provides the delay count
@@ -664,6 +1801,7 @@ class LogicAnalyzer {
         void setDelayCount(int count){
             log("--> setDelayCount: %d", count);
             la_state.delay_count = count;
+            raiseEvent(READ_DLEAY_COUNT);
         }
 
         /// provides the caputring frequency
@@ -671,6 +1809,11 @@ class LogicAnalyzer {
             return la_state.frequecy_value;
         }
 
+        /// provides the frequency of the last capture: this is different from the requested frequency if the automatic timebase is active
+        uint64_t capturedFrequency() {
+            return captured_frequency > 0 ? captured_frequency : la_state.frequecy_value;
+        }
+
         /// Provides the delay time between measurements in microseconds 
         uint64_t delayTimeUs() {
             return la_state.delay_time_us;
@@ -693,6 +1836,27 @@ class LogicAnalyzer {
         /// defines the caputring as continuous
         void setContinuousCapture(bool cont){
             la_state.is_continuous_capture = cont;
+            raiseEvent(FLAGS);
+        }
+
+        /// checks if the demux mode is active: each entry contains 2 subsequent samples of the channels 0-15
+        bool isDemux(){
+            return la_state.is_demux;
+        }
+
+        /// activates the demux mode: this is only supported with a 32 bit PinBitArray
+        bool setDemux(bool demux){
+            if (demux && !LA_IS_DEMUX_SUPPORTED){
+                log("demux requires a 32 bit PinBitArray");
+                demux = false;
+            }
+            if (demux != la_state.is_demux){
+                la_state.is_demux = demux;
+                // the SUMP clock is doubled
+                setupDelay(la_state.divider);
+            }
+            raiseEvent(FLAGS);
+            return demux;
         }
 
         /// defines a event handler that gets notified on some defined events
@@ -702,12 +1866,23 @@ class LogicAnalyzer {
 
         /// Resets the status and buffer
         void clear(){
+            TRACE_BEGIN("clear");
             log("clear");
             setStatus(STOPPED);
+            // only the available entries are dumped: so there is no need to overwrite the data
             if (buffer_ptr!=nullptr){
-                memset(buffer_ptr->data_ptr(),0x00, la_state.max_capture_size*sizeof(PinBitArray));
                 buffer_ptr->clear();
             }
+            if (timestamps_ptr!=nullptr){
+                timestamps_ptr->clear();
+            }
+            if (decoders_ptr!=nullptr){
+                decoders_ptr->events().clear();
+            }
+            if (checksums_ptr!=nullptr){
+                checksums_ptr->clear();
+            }
+            TRACE_END("clear");
         }
 
         /// returns the max buffer size
@@ -730,10 +1905,140 @@ class LogicAnalyzer {
             is_capture_on_arm = capture;
         }
 
+        /// Switch cooperative capturing on/off: the capturing on ARMED status is done in small steps by processCommand(), so that 
+        /// we stay responsive to new commands w/o the need of a separate task.
+        void setCooperativeCapture(bool cooperative, size_t stepBudget=CAPTURE_STEP_BUDGET){
+            is_cooperative_capture = cooperative;
+            step_budget = stepBudget;
+        }
+
+        /// checks if a cooperative capture is in progress
+        bool isCaptureActive() {
+            return is_capture_active;
+        }
+
 
         /// Defines the Description
         void setDescription(const char* name) {
             description = name;
+            metadata_len = 0;
+        }
+
+        /// Activates the recording of a cycle counter timestamp every interval samples: 0 deactivates it. Call after begin! 
+        void setTimestampInterval(uint16_t interval){
+            if (timestamps_ptr!=nullptr){
+                delete timestamps_ptr;
+                timestamps_ptr = nullptr;
+            }
+            if (interval>0){
+                timestamps_ptr = new TimestampLog(interval, la_state.max_capture_size / interval + 2);
+            }
+        }
+
+        /// Provides access to the timestamps: check with hasTimestamps() before calling this method
+        TimestampLog &timestamps() {
+            return *timestamps_ptr;
+        }
+
+        /// Checks if timestamps are recorded
+        bool hasTimestamps() {
+            return timestamps_ptr!=nullptr;
+        }
+
+        /// Activates the CRC32 of each dumped block of blockSize entries: 0 deactivates it. The dumped data is kept in the buffer 
+        /// until the next ARM, so that individual blocks can be requested again. Call after begin! 
+        void setChecksumBlockSize(uint16_t blockSize){
+            if (checksums_ptr!=nullptr){
+                delete checksums_ptr;
+                checksums_ptr = nullptr;
+            }
+            if (blockSize>0){
+                CRC32::begin();
+                checksums_ptr = new BlockChecksums(blockSize, la_state.max_capture_size / blockSize + 2);
+            }
+            metadata_len = 0;
+        }
+
+        /// Checks if the dumped blocks have checksums
+        bool hasChecksums() {
+            return checksums_ptr!=nullptr;
+        }
+
+        /// Offers the framed and acknowledged dump protocol to the host (see FramedDump): it is advertised in the metadata 
+        /// and the host activates it with the vendor command SUMP_VENDOR_FRAMED_DUMP
+        void setFramedDumpSupported(bool supported){
+            if (framed_dump_ptr!=nullptr){
+                delete framed_dump_ptr;
+                framed_dump_ptr = nullptr;
+            }
+            if (supported){
+                CRC32::begin();
+                framed_dump_ptr = new FramedDump();
+            }
+            metadata_len = 0;
+        }
+
+        /// Checks if the framed dump protocol is offered to the host
+        bool isFramedDumpSupported() {
+            return framed_dump_ptr!=nullptr;
+        }
+
+        /// Defines the decoders which are evaluating the captured data before it is dumped: nullptr deactivates them
+        void setDecoders(DecoderRegistry *decoders){
+            decoders_ptr = decoders;
+        }
+
+        /// Switch the automatic timebase on/off: at ARM we determine the slowest frequency which still resolves the shortest pulse
+        void setAutoTimebase(bool active){
+            is_auto_timebase = active;
+        }
+
+        /// checks if the automatic timebase is active
+        bool isAutoTimebase() {
+            return is_auto_timebase;
+        }
+
+        /// Stores the actual capture configuration in the indicated profile slot
+        bool saveProfile(uint8_t slot){
+            if (slot >= LA_PROFILE_COUNT) return false;
+            log("saveProfile %d", slot);
+            CaptureProfile &profile = profiles[slot];
+            profile.is_continuous_capture = la_state.is_continuous_capture;
+            profile.is_demux = la_state.is_demux;
+            profile.divider = la_state.divider;
+            profile.read_count = la_state.read_count;
+            profile.delay_count = la_state.delay_count;
+            profile.frequecy_value = la_state.frequecy_value;
+            profile.delay_time_us = la_state.delay_time_us;
+            profile.trigger_mask = la_state.trigger_mask;
+            profile.trigger_values = la_state.trigger_values;
+            if (capture_ptr!=nullptr){
+                profile.plan = capture_ptr->plan();
+            }
+            profile.is_valid = true;
+            return true;
+        }
+
+        /// Restores the capture configuration from the indicated profile slot: returns false if the slot is empty
+        bool loadProfile(uint8_t slot){
+            if (slot >= LA_PROFILE_COUNT || !profiles[slot].is_valid) return false;
+            log("loadProfile %d", slot);
+            CaptureProfile &profile = profiles[slot];
+            la_state.is_continuous_capture = profile.is_continuous_capture;
+            la_state.is_demux = profile.is_demux;
+            la_state.divider = profile.divider;
+            la_state.read_count = profile.read_count;
+            la_state.delay_count = profile.delay_count;
+            la_state.frequecy_value = profile.frequecy_value;
+            la_state.delay_time_us = profile.delay_time_us;
+            la_state.trigger_mask = profile.trigger_mask;
+            la_state.trigger_values = profile.trigger_values;
+            // the cached plan replaces the recalculation
+            if (capture_ptr!=nullptr){
+                capture_ptr->setPlan(profile.plan);
+            }
+            la_state.raiseEvent(PROFILE);
+            return true;
         }
 
         /// Allows to switch of the automatic buffer allocation - call before begin!
@@ -745,18 +2050,31 @@ class LogicAnalyzer {
         void capture() {
             if (capture_ptr!=nullptr)
                 capture_ptr->capture();
+            restoreTimebase();
         }
 
 
     protected:
         bool is_capture_on_arm = true;
+        bool is_cooperative_capture = false;
+        bool is_capture_active = false;
+        size_t step_budget = CAPTURE_STEP_BUDGET;
         bool do_allocate_buffer = true;
-        uint64_t sump_reset_igorne_timeout=0;
+        bool is_reset = false;
+        bool is_auto_timebase = false;
+        bool is_timebase_changed = false;
+        uint32_t requested_divider = 0;
+        uint64_t requested_frequency = 0;
+        uint64_t captured_frequency = 0;
+        uint8_t *metadata = nullptr;
+        size_t metadata_size = 0;
+        size_t metadata_len = 0;
         AbstractCapture *capture_ptr = nullptr;
         const char* description = "ARDUINO";
         const char* device_id = "1ALS";
         const char* firmware_version = "01.0";
         const char* protocol_version = "\x041\x002";
+        CaptureProfile profiles[LA_PROFILE_COUNT];
 
         /// Provides a reference to the LogicAnalyzerState
         LogicAnalyzerState &state() {
@@ -777,8 +2095,10 @@ class LogicAnalyzer {
 
         /// gets the next 4 byte command
         Sump4ByteComandArg &commandExt() {
-            delay(10);
+            TRACE_BEGIN("config parsing");
+            // readBytes() is waiting with a timeout for the missing bytes
             stream().readBytes(la_state.cmd4.getPtr(), 4);
+            TRACE_END("config parsing");
             return la_state.cmd4;
         }
 
@@ -798,6 +2118,30 @@ class LogicAnalyzer {
             stream().flush();
         }
 
+        /// adds a metadata entry with a string value to the metadata buffer
+        void addMetadata(uint8_t key, const char* str){
+            size_t len = strlen(str) + 1;
+            if (metadata_len + len + 1 > metadata_size){
+                log("metadata %d ignored: buffer too small", key);
+                return;
+            }
+            metadata[metadata_len++] = key;
+            memcpy(metadata + metadata_len, str, len);
+            metadata_len += len;
+        }
+
+        /// adds a metadata entry with a uint32_t value to the metadata buffer
+        void addMetadata(uint8_t key, uint32_t number){
+            if (metadata_len + 5 > metadata_size){
+                log("metadata %d ignored: buffer too small", key);
+                return;
+            }
+            metadata[metadata_len++] = key;
+            uint32_t value = htonl(number);
+            memcpy(metadata + metadata_len, &value, sizeof(uint32_t));
+            metadata_len += sizeof(uint32_t);
+        }
+
         /// Provides the command as PinBitArray
         PinBitArray commandExtPinBitArray() {
             Sump4ByteComandArg cmd = commandExt(); 
@@ -811,8 +2155,11 @@ class LogicAnalyzer {
             }  
         }
 
-        /// raises an event
+        /// raises an event after a change of the configuration: the capture plan is updated before we notify the event handler
         void raiseEvent(Event event){
+            if (capture_ptr!=nullptr){
+                capture_ptr->updatePlan(event);
+            }
             la_state.raiseEvent(event);
         }
 
@@ -831,8 +2178,14 @@ class LogicAnalyzer {
         *
         */
         void setupDelay(uint32_t divider) {
-            // calculate frequency
-            setCaptureFrequency(100000000UL / (divider+1));
+            la_state.divider = divider;
+            // calculate frequency: in demux mode the clock is doubled
+            setCaptureFrequency(sumpClock() / (divider+1));
+        }
+
+        /// Provides the SUMP clock in Hz from which the frequency is derived with the divider
+        uint32_t sumpClock() {
+            return la_state.is_demux ? 200000000UL : 100000000UL;
         }
 
         /**
@@ -842,35 +2195,132 @@ class LogicAnalyzer {
         */
         void sendMetadata() {
             log("sendMetadata");
-            write(0x01, description);
-            write(0x02, firmware_version);
+            if (metadata_len==0){
+                buildMetadata();
+            }
+            stream().write(metadata, metadata_len);
+            stream().flush();
+        }
+
+        /// The metadata does not change: so we prepare the response only once in a buffer which is sized from its content
+        void buildMetadata() {
+            // vendor specific capabilities
+            uint32_t capabilities = (checksums_ptr!=nullptr ? LA_CAPABILITY_CHECKSUMS : 0) | (framed_dump_ptr!=nullptr ? LA_CAPABILITY_FRAMED_DUMP : 0)
+                | (LA_IS_DEMUX_SUPPORTED ? LA_CAPABILITY_DEMUX : 0);
+            size_t size = strlen(description) + 2 + strlen(firmware_version) + 2 + 2 * 5 + (capabilities ? 5 : 0) + strlen(protocol_version) + 1;
+            if (size > metadata_size){
+                if (metadata!=nullptr) delete[] metadata;
+                metadata = new uint8_t[size];
+                metadata_size = metadata==nullptr ? 0 : size;
+            }
+            metadata_len = 0;
+            addMetadata(0x01, description);
+            addMetadata(0x02, firmware_version);
             // number of probes 
-            write(0x20, la_state.pin_numbers);
+            addMetadata(0x20, (uint32_t) la_state.pin_numbers);
             // sample memory 
-            write(0x21, la_state.max_capture_size);
+            addMetadata(0x21, la_state.max_capture_size);
             // sample rate - We do not provide the real max sample rate since this does not have any impact on the gui and provides wrong results!
-            //write(0x23, la_state.max_frequecy_value);
+            //addMetadata(0x23, la_state.max_frequecy_value);
+            if (capabilities){
+                addMetadata(SUMP_META_CAPABILITIES, capabilities);
+            }
             // protocol version & end
-            stream().write(protocol_version, strlen(protocol_version)+1);
-            stream().flush();
+            size_t len = strlen(protocol_version)+1;
+            if (metadata_len + len > metadata_size){
+                log("protocol version ignored: buffer too small");
+                return;
+            }
+            memcpy(metadata + metadata_len, protocol_version, len);
+            metadata_len += len;
+        }
+
+        /// clears the data and starts the capturing
+        void arm() {
+            TRACE_INSTANT("arm");
+            // clear current data
+            clear();
+            captured_frequency = la_state.frequecy_value;
+            if (is_auto_timebase){
+                autoTimebase();
+            }
+            setStatus(ARMED);
+            if (is_capture_on_arm){
+                if (is_cooperative_capture){
+                    is_capture_active = capture_ptr!=nullptr && capture_ptr->captureStart();
+                } else {
+                    capture(); 
+                }
+            }
+        }
+
+        /// Determines the capturing frequency from a short capture at max speed, so that the shortest pulse is covered by 
+        /// AUTO_TIMEBASE_SAMPLES_PER_PULSE samples: If there is no activity we keep the requested frequency
+        void autoTimebase() {
+            if (buffer_ptr==nullptr || pin_reader_ptr==nullptr) return;
+            TRACE_BEGIN("auto timebase");
+            size_t n = buffer_ptr->size() < AUTO_TIMEBASE_SCAN_SIZE ? buffer_ptr->size() : AUTO_TIMEBASE_SCAN_SIZE;
+            PinBitArray *data = buffer_ptr->data_ptr();
+            PinReader &reader = *pin_reader_ptr;
+            unsigned long start = micros();
+            for (size_t j=0; j<n; j++){
+                data[j] = reader.readAll();
+            }
+            unsigned long time_us = micros() - start;
+
+            BlockStatistics statistics;
+            statistics.add(data, n);
+            size_t width = statistics.minPulseWidth();
+            if (width > 0 && time_us > 0){
+                uint64_t scan_frequency = 1000000.0 * n / time_us;
+                uint64_t frequency = width <= AUTO_TIMEBASE_SAMPLES_PER_PULSE ? scan_frequency : scan_frequency * AUTO_TIMEBASE_SAMPLES_PER_PULSE / width;
+                // we can not be faster than the capturing
+                uint64_t max_frequency = capture_ptr!=nullptr ? capture_ptr->capabilities().max_frequency : 0;
+                if (max_frequency > 0 && frequency > max_frequency){
+                    frequency = max_frequency;
+                }
+                uint32_t clock = sumpClock();
+                log("auto timebase: min pulse %lu samples at %lu hz -> %lu hz", (unsigned long) width, (unsigned long) scan_frequency, (unsigned long) frequency);
+                if (frequency > 0){
+                    // the requested timebase is restored after the capture
+                    requested_divider = la_state.divider;
+                    requested_frequency = la_state.frequecy_value;
+                    is_timebase_changed = true;
+                    // round up the divider, so that we do not exceed the frequency
+                    setupDelay((clock + frequency - 1) / frequency - 1);
+                    captured_frequency = la_state.frequecy_value;
+                }
+            }
+            TRACE_END("auto timebase");
+        }
+
+        /// Restores the timebase which was requested by the client before the automatic timebase has changed it
+        void restoreTimebase() {
+            if (!is_timebase_changed) return;
+            is_timebase_changed = false;
+            la_state.divider = requested_divider;
+            setCaptureFrequency(requested_frequency);
         }
 
         /**
          *  Proposess the SUMP commands
          */
         void processCommand(int cmd){
+            TRACE_BEGIN("command");
+            // any other command ends a sequence of resets
+            if (cmd != SUMP_RESET){
+                is_reset = false;
+            }
 
             switch (cmd) {
                 /**
-                 * Resets the buffer and processing status. Resets are repeated 5 times!
+                 * Resets the buffer and processing status. Resets are repeated 5 times: the repetitions do not change anything.
                  */
                 case SUMP_RESET:
-                    // debounce reset
-                    if (millis()>sump_reset_igorne_timeout){
+                    if (!is_reset){
                         log("=>SUMP_RESET");
-                        setStatus(STOPPED);
                         clear();
-                        sump_reset_igorne_timeout = millis()+ 500;
+                        is_reset = true;
                         raiseEvent(RESET);
                     }
                     break;
@@ -898,12 +2348,7 @@ class LogicAnalyzer {
                 */
                 case SUMP_ARM:
                     log("=>SUMP_ARM");
-                    // clear current data
-                    clear();
-                    setStatus(ARMED);
-                    if (is_capture_on_arm){
-                        capture(); 
-                    }
+                    arm();
                     break;
 
                 /*
@@ -971,17 +2416,137 @@ class LogicAnalyzer {
                         Sump4ByteComandArg cmd =  commandExt();
                         la_state.is_continuous_capture = ((cmd.getPtr()[1] & 0B1000000) != 0);
                         log("--> is_continuous_capture: %d\n", la_state.is_continuous_capture);
-                        raiseEvent(FLAGS);
+                        // the divider was sent before the flags: setDemux() recalculates the frequency
+                        bool is_demux = setDemux((cmd.getPtr()[0] & SUMP_FLAG_DEMUX) != 0);
+                        log("--> is_demux: %d", is_demux);
+
+                    }
+                    break;
+
+                /*
+                * Vendor specific: provides the cycle counter timestamps of the last capture
+                */
+                case SUMP_VENDOR_GET_TIMESTAMPS:
+                    log("=>SUMP_VENDOR_GET_TIMESTAMPS");
+                    if (timestamps_ptr!=nullptr){
+                        timestamps_ptr->writeTo(stream());
+                    } else {
+                        // no timestamps: all header values are 0
+                        uint32_t empty[5] = {0, 0, 0, 0, 0};
+                        stream().write((const uint8_t*)empty, sizeof(empty));
+                        stream().flush();
+                    }
+                    break;
+
+                /*
+                * Vendor specific: provides the events of the decoders
+                */
+                case SUMP_VENDOR_GET_DECODER_EVENTS:
+                    log("=>SUMP_VENDOR_GET_DECODER_EVENTS");
+                    if (decoders_ptr!=nullptr){
+                        decoders_ptr->events().writeTo(stream());
+                    } else {
+                        // no decoders: count and dropped are 0
+                        uint32_t empty[2] = {0, 0};
+                        stream().write((const uint8_t*)empty, sizeof(empty));
+                        stream().flush();
+                    }
+                    break;
 
+                /*
+                * Vendor specific: provides the CRC32 of the dumped blocks
+                */
+                case SUMP_VENDOR_GET_CHECKSUMS:
+                    log("=>SUMP_VENDOR_GET_CHECKSUMS");
+                    if (checksums_ptr!=nullptr){
+                        checksums_ptr->writeTo(stream());
+                    } else {
+                        // no checksums: block size and count are 0
+                        uint32_t empty[2] = {0, 0};
+                        stream().write((const uint8_t*)empty, sizeof(empty));
+                        stream().flush();
+                    }
+                    break;
+
+                /*
+                * Vendor specific: sends the block (index in the first 2 bytes) of the last dump again
+                */
+                case SUMP_VENDOR_RESEND_BLOCK: {
+                        Sump4ByteComandArg cmd = commandExt();
+                        log("=>SUMP_VENDOR_RESEND_BLOCK %d", cmd.get16(0));
+                        if (checksums_ptr!=nullptr && cmd.get16(0) < checksums_ptr->size()){
+                            checksums_ptr->writeBlock(cmd.get16(0));
+                            stream().flush();
+                        }
                     }
                     break;
 
+                /*
+                * Vendor specific: activates the framed dump with the frame size in entries (big endian in the first 2 bytes) 
+                * and the window (third byte): a frame size of 0 deactivates it
+                */
+                case SUMP_VENDOR_FRAMED_DUMP: {
+                        Sump4ByteComandArg cmd = commandExt();
+                        uint8_t *arg = cmd.getPtr();
+                        uint16_t block_size = arg[0] << 8 | arg[1];
+                        log("=>SUMP_VENDOR_FRAMED_DUMP %d %d", block_size, arg[2]);
+                        if (framed_dump_ptr!=nullptr){
+                            framed_dump_ptr->setActive(block_size, arg[2]);
+                        }
+                    }
+                    break;
+
+                /*
+                * Vendor specific: stores the actual configuration in the slot which is given in the first byte
+                */
+                case SUMP_VENDOR_SAVE_PROFILE: {
+                        Sump4ByteComandArg cmd = commandExt();
+                        log("=>SUMP_VENDOR_SAVE_PROFILE %d", cmd.getPtr()[0]);
+                        saveProfile(cmd.getPtr()[0]);
+                    }
+                    break;
+
+                /*
+                * Vendor specific: provides the actual capturing frequency e.g. determined by the automatic timebase
+                */
+                case SUMP_VENDOR_GET_FREQUENCY: {
+                        log("=>SUMP_VENDOR_GET_FREQUENCY");
+                        uint32_t frequency = htonl((uint32_t) capturedFrequency());
+                        stream().write((const uint8_t*)&frequency, sizeof(uint32_t));
+                        stream().flush();
+                    }
+                    break;
+
+                /*
+                * Vendor specific: late acknowledgements of the framed dump are ignored
+                */
+                case SUMP_VENDOR_ACK:
+                case SUMP_VENDOR_NAK:
+                    commandExt();
+                    log("=>SUMP_VENDOR_ACK/NAK ignored");
+                    break;
+
                 /* ignore any unrecognized bytes. */
                 default:
+                    /*
+                    * Vendor specific: loads the profile slot (cmd - SUMP_VENDOR_ARM_PROFILE) and starts the capturing
+                    */
+                    if (cmd >= SUMP_VENDOR_ARM_PROFILE && cmd < SUMP_VENDOR_ARM_PROFILE + LA_PROFILE_COUNT){
+                        log("=>SUMP_VENDOR_ARM_PROFILE %d", cmd - SUMP_VENDOR_ARM_PROFILE);
+                        if (loadProfile(cmd - SUMP_VENDOR_ARM_PROFILE)){
+                            arm();
+                        }
+                        break;
+                    }
+                    // commands of the capture implementation
+                    if (capture_ptr!=nullptr && capture_ptr->processCommand(cmd)){
+                        break;
+                    }
                     log("=>UNHANDLED command: %d", cmd);
                     break;
                 
             };
+            TRACE_END("command");
     }
 };
 
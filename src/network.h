@@ -9,17 +9,17 @@
 
 #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
 
-#define htons(x) x
-#define ntohs(x) x
-#define htonl(x) x
-#define ntohl(x) x
+#define htons(x) ((uint16_t)(x))
+#define ntohs(x) htons(x)
+#define htonl(x) ((uint32_t)(x))
+#define ntohl(x) htonl(x)
 
 #else
 // The Pico is little endian !
 #define IS_LITTLE_ENDIAN
-#define htons(x) ( ((x)<< 8 & 0xFF00) | ((x)>> 8 & 0x00FF) )
+#define htons(x) ((uint16_t)( ((x)<< 8 & 0xFF00) | ((x)>> 8 & 0x00FF) ))
 #define ntohs(x) htons(x)
-#define htonl(x) ( ((x)<<24 & 0xFF000000UL) | ((x)<< 8 & 0x00FF0000UL) | ((x)>> 8 & 0x0000FF00UL) | ((x)>>24 & 0x000000FFUL) )
+#define htonl(x) ((uint32_t)( ((x)<<24 & 0xFF000000UL) | ((x)<< 8 & 0x00FF0000UL) | ((x)>> 8 & 0x0000FF00UL) | ((x)>>24 & 0x000000FFUL) ))
 #define ntohl(x) htonl(x)
 
 #endif
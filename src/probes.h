@@ -0,0 +1,121 @@
+#pragma once
+/**
+ * @brief Compile time activated probes which measure the processor cycles that are spent in the different stages of the 
+ * capturing. Define LOGIC_ANALYZER_PROBES before including logic_analyzer.h to activate them: otherwise the macros are empty. 
+ * They are not supported on AVR because there is no cycle counter.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * 
+ */
+
+#include "config.h"
+
+// Relevant bits of the cycle counter
+#ifndef CYCLE_COUNT_MASK
+#define CYCLE_COUNT_MASK 0xFFFFFFFFUL
+#endif
+
+// Frequency of the cycle counter in Hz
+#ifndef CYCLE_COUNT_FREQUENCY
+#define CYCLE_COUNT_FREQUENCY F_CPU
+#endif
+
+// Number of cycles between two subsequent values of the cycle counter
+#ifndef CYCLE_COUNT_RESOLUTION
+#define CYCLE_COUNT_RESOLUTION 1
+#endif
+
+// On AVR the cycleCount() is derived from micros() with a resolution of 4us, which is longer than the measured stages
+#if defined(LOGIC_ANALYZER_PROBES) && defined(AVR)
+#warning "The probes are not supported on AVR"
+#undef LOGIC_ANALYZER_PROBES
+#endif
+
+#ifdef LOGIC_ANALYZER_PROBES
+#define PROBE_START(stage) uint32_t probe_start_##stage = logic_analyzer::cycleCount()
+#define PROBE_END(stage) logic_analyzer::probes().add(stage, probe_start_##stage)
+#else
+#define PROBE_START(stage)
+#define PROBE_END(stage)
+#endif
+
+namespace logic_analyzer {
+
+/// Measured stages 
+enum ProbeStage : uint8_t {PROBE_READ, PROBE_BUFFER_WRITE, PROBE_LOOP_CHECK, PROBE_DELAY, PROBE_OUTPUT, PROBE_PIO_ARM, PROBE_PIO_WAIT, PROBE_STAGE_COUNT};
+
+/**
+ * @brief Table with the accumulated cycles per ProbeStage
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class Probes {
+    public:
+        /// adds the cycles since the start value to the stage
+        inline void add(ProbeStage stage, uint32_t start) {
+            uint32_t cycles = (cycleCount() - start) & CYCLE_COUNT_MASK;
+            cycle_counts[stage] += cycles > overhead ? cycles - overhead : 0;
+            call_counts[stage]++;
+        }
+
+        /// resets all counters and determines the overhead of a measurement 
+        void clear() {
+            memset(cycle_counts, 0, sizeof(cycle_counts));
+            memset(call_counts, 0, sizeof(call_counts));
+            overhead = CYCLE_COUNT_MASK;
+            for (int j=0; j<10; j++){
+                uint32_t start = cycleCount();
+                uint32_t cycles = (cycleCount() - start) & CYCLE_COUNT_MASK;
+                if (cycles < overhead) overhead = cycles;
+            }
+        }
+
+        /// Provides the total number of cycles of a stage
+        uint64_t cycles(ProbeStage stage) {
+            return cycle_counts[stage];
+        }
+
+        /// Provides the number of measurements of a stage
+        uint32_t count(ProbeStage stage) {
+            return call_counts[stage];
+        }
+
+        /// prints the breakdown of the cycles per stage
+        void printTo(Print &out) {
+            static const char* names[] = {"read", "buffer write", "loop check", "delay", "output", "pio arm", "pio wait"};
+            char line[100];
+            char cycles[21];
+            char avg[21];
+            for (int j=0; j<PROBE_STAGE_COUNT; j++){
+                if (call_counts[j]==0) continue;
+                snprintf(line, 100, "%-14s calls: %10lu cycles: %12s avg: %s", names[j], (unsigned long) call_counts[j], 
+                    toString(cycle_counts[j], cycles, sizeof(cycles)), toString(cycle_counts[j] / call_counts[j], avg, sizeof(avg)));
+                out.println(line);
+            }
+        }
+
+    protected:
+        uint64_t cycle_counts[PROBE_STAGE_COUNT] = {0};
+        uint32_t call_counts[PROBE_STAGE_COUNT] = {0};
+        uint32_t overhead = 0;
+
+        /// converts the value to a decimal string at the end of the buffer: printf does not support 64 bit values everywhere
+        static const char* toString(uint64_t value, char *buffer, size_t len) {
+            char *ptr = buffer + len - 1;
+            *ptr = 0;
+            do {
+                *--ptr = '0' + value % 10;
+                value /= 10;
+            } while (value > 0 && ptr > buffer);
+            return ptr;
+        }
+
+};
+
+/// Provides the global Probes
+inline Probes &probes() {
+    static Probes instance;
+    return instance;
+}
+
+} // namespace
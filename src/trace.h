@@ -0,0 +1,105 @@
+#pragma once
+/**
+ * @brief Compile time activated recording of the phases of a capturing session (command processing, ARM, trigger wait, 
+ * capture, dump...) which can be exported in the Chrome trace JSON format, so that it can be displayed in 
+ * chrome://tracing or Perfetto. Define LOGIC_ANALYZER_TRACE before including logic_analyzer.h to activate it:
+ * otherwise the macros are empty.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * 
+ */
+
+#include "Arduino.h"
+
+// Max number of recorded trace events
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE 256
+#endif
+
+#ifdef LOGIC_ANALYZER_TRACE
+#define TRACE_BEGIN(name) logic_analyzer::tracer().add(name, 'B')
+#define TRACE_END(name) logic_analyzer::tracer().add(name, 'E')
+#define TRACE_INSTANT(name) logic_analyzer::tracer().add(name, 'i')
+#else
+#define TRACE_BEGIN(name)
+#define TRACE_END(name)
+#define TRACE_INSTANT(name)
+#endif
+
+namespace logic_analyzer {
+
+/**
+ * @brief Recorded trace event
+ */
+struct TraceEvent {
+    const char* name;
+    uint32_t timestamp_us;
+    char phase;
+};
+
+/**
+ * @brief Lock free recorder for trace events: each writer reserves its entry with an atomic increment, so that 
+ * we can record from both cores and from interrupts. If the buffer is full the events are dropped.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class Tracer {
+    public:
+        /// records an event: phase is 'B' (begin), 'E' (end) or 'i' (instant)
+        inline void add(const char* name, char phase) {
+            uint32_t timestamp = micros();
+            uint16_t pos = __atomic_fetch_add(&write_pos, 1, __ATOMIC_RELAXED);
+            if (pos >= TRACE_BUFFER_SIZE){
+                // prevent an overflow of the position
+                write_pos = TRACE_BUFFER_SIZE;
+                return;
+            }
+            TraceEvent &event = events[pos];
+            event.name = name;
+            event.timestamp_us = timestamp;
+            event.phase = phase;
+        }
+
+        /// removes all recorded events
+        void clear() {
+            write_pos = 0;
+        }
+
+        /// Provides the number of recorded events
+        size_t size() {
+            return write_pos < TRACE_BUFFER_SIZE ? write_pos : TRACE_BUFFER_SIZE;
+        }
+
+        /// Provides the indicated event
+        TraceEvent &operator[](size_t idx) {
+            return events[idx];
+        }
+
+        /// writes the recorded events in the Chrome trace JSON format
+        void printTo(Print &out) {
+            char line[80];
+            out.print("{\"traceEvents\":[");
+            for (size_t j=0; j<size(); j++){
+                TraceEvent &event = events[j];
+                snprintf(line, 80, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu,\"pid\":1,\"tid\":1%s}", j==0 ? "" : ",",
+                    event.name, event.phase, (unsigned long) event.timestamp_us, event.phase=='i' ? ",\"s\":\"g\"" : "");
+                out.print(line);
+            }
+            out.println("\n]}");
+        }
+
+    protected:
+        TraceEvent events[TRACE_BUFFER_SIZE] = {};
+        volatile uint16_t write_pos = 0;
+
+};
+
+#ifdef LOGIC_ANALYZER_TRACE
+/// Provides the global Tracer: it only exists if the tracing is active
+inline Tracer &tracer() {
+    static Tracer instance;
+    return instance;
+}
+#endif
+
+} // namespace
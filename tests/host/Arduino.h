@@ -0,0 +1,157 @@
+/**
+ * @file Arduino.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Minimal Arduino API to run the logic analyzer on the host: the pins are read from host_samples and the
+ * SUMP communication is done with a HostStream.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#ifndef F_CPU
+#define F_CPU 1000000000UL
+#endif
+
+typedef uint8_t byte;
+
+#define INPUT 0
+#define OUTPUT 1
+#define LOW 0
+#define HIGH 1
+
+inline unsigned long micros() {
+    using namespace std::chrono;
+    static auto start = steady_clock::now();
+    return duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+inline unsigned long millis() { return micros() / 1000; }
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(unsigned int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline void yield() {}
+
+/// Output API
+class Print {
+    public:
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t *data, size_t len) {
+            size_t result = 0;
+            while (len--) result += write(*data++);
+            return result;
+        }
+        size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+        size_t write(const char *data, size_t len) { return write((const uint8_t *)data, len); }
+        virtual int availableForWrite() { return 0; }
+        virtual void flush() {}
+        size_t print(const char *str) { return write(str); }
+        size_t print(unsigned long value) { return printf("%lu", value); }
+        size_t print(int value) { return printf("%d", value); }
+        size_t print(double value) { return printf("%.2f", value); }
+        size_t println(const char *str = "") { return write(str) + write("\n"); }
+        size_t println(unsigned long value) { return print(value) + write("\n"); }
+        size_t println(double value) { return print(value) + write("\n"); }
+        size_t printf(const char *fmt, ...) {
+            char buffer[256];
+            va_list args;
+            va_start(args, fmt);
+            vsnprintf(buffer, sizeof(buffer), fmt, args);
+            va_end(args);
+            return write(buffer);
+        }
+};
+
+/// Input and output API
+class Stream : public Print {
+    public:
+        virtual int available() = 0;
+        virtual int read() = 0;
+        virtual int peek() = 0;
+        void setTimeout(unsigned long timeout) { timeout_ms = timeout; }
+        size_t readBytes(uint8_t *data, size_t len) {
+            size_t count = 0;
+            while (count < len) {
+                int value = read();
+                if (value < 0) break;
+                data[count++] = value;
+            }
+            return count;
+        }
+        size_t readBytes(char *data, size_t len) { return readBytes((uint8_t *)data, len); }
+
+    protected:
+        unsigned long timeout_ms = 1000;
+};
+
+/// Stream which collects the output and provides the queued input: on_flush can be used to simulate the host
+class HostStream : public Stream {
+    public:
+        std::deque<uint8_t> in;
+        std::vector<uint8_t> out;
+        std::function<void()> on_flush;
+
+        int available() override { return in.size(); }
+        int read() override {
+            if (in.empty()) return -1;
+            int result = in.front();
+            in.pop_front();
+            return result;
+        }
+        int peek() override { return in.empty() ? -1 : in.front(); }
+        size_t write(uint8_t c) override {
+            out.push_back(c);
+            return 1;
+        }
+        size_t write(const uint8_t *data, size_t len) override {
+            out.insert(out.end(), data, data + len);
+            return len;
+        }
+        using Print::write;
+        void flush() override {
+            if (on_flush) on_flush();
+        }
+        operator bool() { return true; }
+};
+
+namespace logic_analyzer {
+
+// a test can select a wider PinBitArray
+#ifndef HOST_PIN_BIT_ARRAY
+#define HOST_PIN_BIT_ARRAY uint8_t
+#endif
+
+typedef HOST_PIN_BIT_ARRAY PinBitArray;
+
+/// Samples which are returned by the PinReader one after the other (repeated at the end)
+inline std::vector<PinBitArray> host_samples;
+inline size_t host_pos = 0;
+
+/// Reads the pins from host_samples
+class PinReader {
+    public:
+        PinReader(int startPin) {}
+        inline PinBitArray readAll() {
+            if (host_samples.empty()) return 0;
+            return host_samples[host_pos++ % host_samples.size()];
+        }
+};
+
+/// Cycle counter of a CPU running at F_CPU: one cycle per nanosecond
+inline uint32_t cycleCount() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
@@ -0,0 +1,129 @@
+/**
+ * @file framed_dump_client.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Host side of the framed dump protocol
+ */
+#pragma once
+
+#include <map>
+#include <vector>
+#include "logic_analyzer.h"
+
+namespace logic_analyzer {
+
+/**
+ * @brief Receives a framed dump: the frames are searched by the sync byte and only accepted if the CRC32 is valid,
+ * so that the client resynchronizes after lost or corrupted bytes. The frames are put into order and the client
+ * provides the SUMP_VENDOR_ACK for the last frame w/o gap and a SUMP_VENDOR_NAK for the first missing frame,
+ * when a later one has been received. All numbers are big endian.
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FramedDumpClient {
+    public:
+        /// Defines the max number of entries in a frame, which is used to reject corrupted headers
+        FramedDumpClient(uint16_t blockSize) {
+            block_size = blockSize;
+        }
+
+        /// Creates the SUMP_VENDOR_FRAMED_DUMP command which activates the protocol on the device
+        static std::vector<uint8_t> activateCommand(uint16_t blockSize, uint8_t window) {
+            return {SUMP_VENDOR_FRAMED_DUMP, (uint8_t)(blockSize >> 8), (uint8_t) blockSize, window, 0};
+        }
+
+        /// Processes the received bytes and adds the resulting ACK/NAK commands to the commands
+        void receive(const uint8_t *data, size_t len, std::vector<uint8_t> &commands) {
+            pending.insert(pending.end(), data, data + len);
+            size_t pos = 0;
+            while (pos + header_size <= pending.size()) {
+                if (pending[pos] != FRAMED_DUMP_SYNC) {
+                    pos++;
+                    continue;
+                }
+                const uint8_t *header = pending.data() + pos;
+                uint32_t seq = get32(header + 1);
+                uint16_t count = header[5] << 8 | header[6];
+                size_t frame_size = header_size + count * sizeof(PinBitArray) + sizeof(uint32_t);
+                if (count > block_size) {
+                    pos++;
+                    continue;
+                }
+                if (pos + frame_size > pending.size()) break;
+                uint32_t crc = CRC32::calculate(header + 1, frame_size - 1 - sizeof(uint32_t));
+                if (crc != get32(header + frame_size - sizeof(uint32_t))) {
+                    // no valid frame: we search the next sync byte
+                    corrupted_count++;
+                    pos++;
+                    continue;
+                }
+                addFrame(seq, header + header_size, count, commands);
+                pos += frame_size;
+            }
+            pending.erase(pending.begin(), pending.begin() + pos);
+        }
+
+        /// Checks if all frames incl. the empty end frame have been received
+        bool isComplete() {
+            return is_end_received && next_seq > end_seq;
+        }
+
+        /// Provides the received data in the order of the frames
+        std::vector<PinBitArray> data() {
+            std::vector<PinBitArray> result;
+            for (auto &frame : frames) {
+                result.insert(result.end(), frame.second.begin(), frame.second.end());
+            }
+            return result;
+        }
+
+        /// Provides the number of valid frames incl. duplicates
+        size_t validFrames() {
+            return valid_count;
+        }
+
+        /// Provides the number of rejected sync positions
+        size_t corruptedFrames() {
+            return corrupted_count;
+        }
+
+    protected:
+        static const size_t header_size = 7;
+        std::vector<uint8_t> pending;
+        std::map<uint32_t, std::vector<PinBitArray>> frames;
+        uint16_t block_size;
+        uint32_t next_seq = 0;
+        uint32_t end_seq = 0;
+        bool is_end_received = false;
+        size_t valid_count = 0;
+        size_t corrupted_count = 0;
+
+        static uint32_t get32(const uint8_t *data) {
+            return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+        }
+
+        static void addCommand(std::vector<uint8_t> &commands, uint8_t cmd, uint32_t seq) {
+            uint8_t command[5] = {cmd, (uint8_t)(seq >> 24), (uint8_t)(seq >> 16), (uint8_t)(seq >> 8), (uint8_t) seq};
+            commands.insert(commands.end(), command, command + sizeof(command));
+        }
+
+        /// stores a valid frame and acknowledges the frames w/o gap
+        void addFrame(uint32_t seq, const uint8_t *entries, uint16_t count, std::vector<uint8_t> &commands) {
+            valid_count++;
+            if (count == 0) {
+                is_end_received = true;
+                end_seq = seq;
+            }
+            const PinBitArray *values = (const PinBitArray *) entries;
+            frames[seq] = std::vector<PinBitArray>(values, values + count);
+            if (seq > next_seq && frames.count(next_seq) == 0) {
+                addCommand(commands, SUMP_VENDOR_NAK, next_seq);
+            }
+            while (frames.count(next_seq) > 0) next_seq++;
+            if (next_seq > 0) {
+                addCommand(commands, SUMP_VENDOR_ACK, next_seq - 1);
+            }
+        }
+};
+
+} // namespace
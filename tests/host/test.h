@@ -0,0 +1,21 @@
+/**
+ * @file test.h
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Minimal checks for the host tests: a failed check is reported and the test returns 1 at the end
+ */
+#pragma once
+
+#include <stdio.h>
+
+inline int test_failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++; \
+        } \
+    } while (0)
+
+#define TEST_RESULT() (test_failures == 0 ? 0 : 1)
@@ -0,0 +1,106 @@
+/**
+ * @file test_block_scanner.cpp
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Compares the word parallel BlockScanner with a sample by sample reference implementation on random
+ * trigger sequences and random data which is split into blocks of random size.
+ */
+#include "Arduino.h"
+#include "logic_analyzer.h"
+#include "test.h"
+
+using namespace logic_analyzer;
+
+/// Trigger stage of the reference implementation
+struct ReferenceStage {
+    PinBitArray mask;
+    PinBitArray value;
+    bool is_edge;
+};
+
+/// Straightforward evaluation of the trigger sequence: provides all positions which complete the sequence
+std::vector<size_t> referenceScan(const std::vector<ReferenceStage> &stages, const std::vector<PinBitArray> &data) {
+    std::vector<size_t> result;
+    size_t stage = 0;
+    for (size_t j = 0; j < data.size(); j++) {
+        const ReferenceStage &s = stages[stage];
+        // the first sample has no predecessor, so it can't be an edge
+        PinBitArray prev = j > 0 ? data[j - 1] : data[j];
+        bool is_match = (data[j] & s.mask) == (s.value & s.mask);
+        if (s.is_edge) is_match = is_match && (prev & s.mask) != (s.value & s.mask);
+        if (is_match && ++stage == stages.size()) {
+            result.push_back(j);
+            stage = 0;
+        }
+    }
+    return result;
+}
+
+/// Scans the data in blocks of random size and continues after each match
+std::vector<size_t> blockScan(BlockScanner &scanner, const std::vector<PinBitArray> &data) {
+    std::vector<size_t> result;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t len = 1 + rand() % 64;
+        if (len > data.size() - pos) len = data.size() - pos;
+        size_t offset = 0;
+        while (offset < len) {
+            long idx = scanner.scan(data.data() + pos + offset, len - offset);
+            if (idx < 0) break;
+            result.push_back(pos + offset + idx);
+            offset += idx + 1;
+        }
+        pos += len;
+    }
+    return result;
+}
+
+/// random mask with 1 to 3 bits, so that the stages are matching from time to time
+PinBitArray randomMask() {
+    PinBitArray result = 0;
+    int bits = 1 + rand() % 3;
+    for (int j = 0; j < bits; j++) result |= 1 << (rand() % 8);
+    return result;
+}
+
+int main() {
+    srand(1);
+    int matches = 0;
+    for (int run = 0; run < 500; run++) {
+        // slowly changing data with some bursts
+        std::vector<PinBitArray> data(1000 + rand() % 1000);
+        PinBitArray value = rand();
+        for (auto &sample : data) {
+            if (rand() % 4 == 0) value ^= 1 << (rand() % 8);
+            if (rand() % 50 == 0) value = rand();
+            sample = value;
+        }
+
+        std::vector<ReferenceStage> stages;
+        BlockScanner scanner;
+        int count = 1 + rand() % BLOCK_SCANNER_MAX_STAGES;
+        for (int j = 0; j < count; j++) {
+            ReferenceStage stage = {randomMask(), (PinBitArray)rand(), rand() % 2 == 0};
+            stages.push_back(stage);
+            if (stage.is_edge) {
+                scanner.addEdge(stage.mask, stage.value);
+            } else {
+                scanner.addPattern(stage.mask, stage.value);
+            }
+        }
+
+        std::vector<size_t> expected = referenceScan(stages, data);
+        std::vector<size_t> actual = blockScan(scanner, data);
+        CHECK(actual == expected);
+        matches += expected.size();
+    }
+    printf("compared %d matches\n", matches);
+    CHECK(matches > 1000);
+
+    // without any stage the first sample is matching
+    BlockScanner empty;
+    PinBitArray data[4] = {1, 2, 3, 4};
+    CHECK(empty.scan(data, 4) == 0);
+    CHECK(empty.scan(data, 0) == -1);
+    return TEST_RESULT();
+}
@@ -0,0 +1,55 @@
+/**
+ * @file test_crc32.cpp
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Checks the CRC32 with the standard check value and compares the nibble and the slice-by-8 calculation on 
+ * random data which is split into blocks of random size.
+ */
+#include "Arduino.h"
+#include "crc32.h"
+#include "test.h"
+
+using namespace logic_analyzer;
+
+/// Calculates the checksum of the data in blocks of random size
+uint32_t splitCalculate(const std::vector<uint8_t> &data) {
+    uint32_t crc = 0;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t len = std::min<size_t>(rand() % 20, data.size() - pos);
+        crc = CRC32::calculate(data.data() + pos, len, crc);
+        pos += len;
+    }
+    return crc;
+}
+
+int main() {
+    srand(1);
+    const char *check = "123456789";
+    std::vector<std::vector<uint8_t>> samples;
+    for (int j = 0; j < 100; j++) {
+        std::vector<uint8_t> data(rand() % 200);
+        for (auto &value : data) value = rand();
+        samples.push_back(data);
+    }
+
+    // w/o begin() we use the nibble table
+    CHECK(CRC32::calculate(check, 9) == 0xCBF43926UL);
+    CHECK(CRC32::calculate(check, 0) == 0);
+    std::vector<uint32_t> nibble_crcs;
+    for (auto &data : samples) {
+        uint32_t crc = CRC32::calculate(data.data(), data.size());
+        CHECK(splitCalculate(data) == crc);
+        nibble_crcs.push_back(crc);
+    }
+
+    // the slice-by-8 tables must give the same results
+    CHECK(CRC32::begin());
+    CHECK(CRC32::calculate(check, 9) == 0xCBF43926UL);
+    CHECK(CRC32::calculate(check + 4, 5, CRC32::calculate(check, 4)) == 0xCBF43926UL);
+    for (size_t j = 0; j < samples.size(); j++) {
+        CHECK(CRC32::calculate(samples[j].data(), samples[j].size()) == nibble_crcs[j]);
+        CHECK(splitCalculate(samples[j]) == nibble_crcs[j]);
+    }
+    return TEST_RESULT();
+}
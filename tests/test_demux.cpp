@@ -0,0 +1,77 @@
+/**
+ * @file test_demux.cpp
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Checks the OLS demux layout with a 32 bit PinBitArray: the SUMP flag doubles the clock and each entry 
+ * contains 2 subsequent samples of the channels 0-15.
+ */
+#define HOST_PIN_BIT_ARRAY uint32_t
+#include "Arduino.h"
+#include "logic_analyzer.h"
+#include "test.h"
+
+using namespace logic_analyzer;
+
+const size_t entries = 1000;
+
+HostStream stream;
+LogicAnalyzer logicAnalyzer;
+Capture capture(2000000, 600000);
+
+/// adds a long SUMP command with a little endian argument
+void command(uint8_t cmd, uint32_t arg) {
+    stream.in.push_back(cmd);
+    for (int j = 0; j < 4; j++) stream.in.push_back(arg >> (8 * j));
+}
+
+/// captures with the indicated divider and checks the packed samples
+void checkCapture(uint32_t divider) {
+    command(SUMP_SET_DIVIDER, divider);
+    command(SUMP_SET_READ_DELAY_COUNT, (entries / 4 - 1) | (entries / 4 - 1) << 16);
+    command(SUMP_SET_FLAGS, SUMP_FLAG_DEMUX);
+    while (stream.available()) logicAnalyzer.processCommand();
+    CHECK(logicAnalyzer.isDemux());
+    CHECK(logicAnalyzer.captureFrequency() == 200000000UL / (divider + 1));
+
+    host_pos = 0;
+    stream.out.clear();
+    stream.in.push_back(SUMP_ARM);
+    logicAnalyzer.processCommand();
+    CHECK(stream.out.size() == entries * sizeof(PinBitArray));
+    if (stream.out.size() != entries * sizeof(PinBitArray)) return;
+    const PinBitArray *data = (const PinBitArray *) stream.out.data();
+    bool is_valid = true;
+    for (size_t j = 0; j < entries; j++) {
+        PinBitArray first = host_samples[2 * j] & 0xFFFF;
+        PinBitArray second = host_samples[2 * j + 1] & 0xFFFF;
+        is_valid = is_valid && data[j] == (first | second << 16);
+    }
+    printf("divider %lu: %lu hz, layout valid: %d\n", (unsigned long) divider, (unsigned long) logicAnalyzer.captureFrequency(), is_valid);
+    CHECK(is_valid);
+}
+
+int main() {
+    srand(1);
+    for (size_t j = 0; j < 2 * entries; j++) host_samples.push_back(rand());
+    logicAnalyzer.begin(stream, &capture, entries, 0, 32);
+
+    // the capability is advertised in the metadata
+    stream.in.push_back(SUMP_GET_METADATA);
+    logicAnalyzer.processCommand();
+    bool is_advertised = false;
+    for (size_t j = 0; j + 4 < stream.out.size(); j++) {
+        if (stream.out[j] == SUMP_META_CAPABILITIES && (stream.out[j + 4] & LA_CAPABILITY_DEMUX)) is_advertised = true;
+    }
+    CHECK(is_advertised);
+
+    // max speed and paced
+    checkCapture(49);
+    checkCapture(999);
+
+    // without the flag we have one sample per entry at the normal clock
+    command(SUMP_SET_FLAGS, 0);
+    while (stream.available()) logicAnalyzer.processCommand();
+    CHECK(!logicAnalyzer.isDemux());
+    CHECK(logicAnalyzer.captureFrequency() == 100000000UL / 1000);
+    return TEST_RESULT();
+}
@@ -0,0 +1,118 @@
+/**
+ * @file test_framed_dump.cpp
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Sends the framed dump over a simulated lossy link, which drops and corrupts random bytes, to the
+ * FramedDumpClient: the received data must be identical to the captured data. For each error rate we report the
+ * overhead and the time of the transfer.
+ */
+// short timeout, so that the lost end of a window is resent quickly
+#define FRAMED_DUMP_TIMEOUT_MS 2
+#define FRAMED_DUMP_RETRIES 100
+#include "Arduino.h"
+#include "logic_analyzer.h"
+#include "framed_dump_client.h"
+#include "test.h"
+
+using namespace logic_analyzer;
+
+const uint16_t block_size = 100;
+const size_t capture_size = 4000;
+
+HostStream stream;
+LogicAnalyzer logicAnalyzer;
+Capture capture(2000000, 600000);
+
+/// captured data which is retained in the buffer
+std::vector<PinBitArray> capturedData() {
+    std::vector<PinBitArray> result;
+    const PinBitArray *block;
+    size_t offset = 0, len;
+    while ((len = buffer_ptr->peekBlock(offset, block, capture_size)) > 0) {
+        result.insert(result.end(), block, block + len);
+        offset += len;
+    }
+    return result;
+}
+
+/// Runs a capture with a dump over a link with the indicated error rate per byte
+bool transfer(double errorRate) {
+    FramedDumpClient client(block_size);
+    size_t sent = 0, lost = 0;
+    stream.out.clear();
+    stream.on_flush = [&]() {
+        // the link drops or corrupts bytes from the device to the host
+        std::vector<uint8_t> received;
+        for (size_t j = sent; j < stream.out.size(); j++) {
+            uint8_t value = stream.out[j];
+            if (rand() < errorRate * RAND_MAX) {
+                lost++;
+                if (rand() % 2) continue;
+                value ^= 1 << (rand() % 8);
+            }
+            received.push_back(value);
+        }
+        sent = stream.out.size();
+        std::vector<uint8_t> commands;
+        client.receive(received.data(), received.size(), commands);
+        stream.in.insert(stream.in.end(), commands.begin(), commands.end());
+    };
+    unsigned long start = millis();
+    stream.in.push_back(SUMP_ARM);
+    logicAnalyzer.processCommand();
+    unsigned long time_ms = millis() - start;
+    stream.on_flush = nullptr;
+    // late acknowledgements are ignored
+    while (stream.available()) logicAnalyzer.processCommand();
+
+    size_t payload = capture_size * sizeof(PinBitArray);
+    printf("error rate %.4f: %lu bytes (%.1f%% overhead), %lu errors, %lu valid frames, %lu rejected, %lu ms\n", errorRate,
+           (unsigned long) sent, 100.0 * (sent - payload) / payload, (unsigned long) lost, (unsigned long) client.validFrames(),
+           (unsigned long) client.corruptedFrames(), time_ms);
+    return client.isComplete() && client.data() == capturedData();
+}
+
+int main() {
+    srand(1);
+    for (size_t j = 0; j < capture_size; j++) host_samples.push_back(rand());
+    logicAnalyzer.begin(stream, &capture, capture_size, 0, 8);
+    logicAnalyzer.setFramedDumpSupported(true);
+    logicAnalyzer.setReadCount(capture_size);
+    logicAnalyzer.setDelayCount(capture_size);
+    logicAnalyzer.setCaptureFrequency(100000);
+    std::vector<uint8_t> activate = FramedDumpClient::activateCommand(block_size, 4);
+    stream.in.insert(stream.in.end(), activate.begin(), activate.end());
+    logicAnalyzer.processCommand();
+    CHECK(framed_dump_ptr->blockSize() == block_size);
+    CHECK(framed_dump_ptr->window() == 4);
+
+    for (double error_rate : {0.0, 0.0001, 0.001, 0.005}) {
+        CHECK(transfer(error_rate));
+    }
+
+    // any other command aborts the dump and is left for processCommand()
+    stream.out.clear();
+    stream.on_flush = [&]() {
+        if (stream.in.empty()) stream.in.push_back(SUMP_RESET);
+    };
+    stream.in.push_back(SUMP_ARM);
+    logicAnalyzer.processCommand();
+    stream.on_flush = nullptr;
+    CHECK(stream.available() == 1 && stream.peek() == SUMP_RESET);
+    CHECK(stream.out.size() < capture_size);
+    logicAnalyzer.processCommand();
+
+    // an incomplete acknowledgement aborts the dump after the first window and the input is dropped
+    stream.out.clear();
+    bool is_sent = false;
+    stream.on_flush = [&]() {
+        if (!is_sent) stream.in.insert(stream.in.end(), {SUMP_VENDOR_ACK, 0, 0});
+        is_sent = true;
+    };
+    stream.in.push_back(SUMP_ARM);
+    logicAnalyzer.processCommand();
+    stream.on_flush = nullptr;
+    CHECK(stream.available() == 0);
+    CHECK(stream.out.size() == 4 * (7 + block_size * sizeof(PinBitArray) + 4));
+    return TEST_RESULT();
+}
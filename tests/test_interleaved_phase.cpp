@@ -0,0 +1,73 @@
+/**
+ * @file test_interleaved_phase.cpp
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Validates the phase and slot offset estimation of the DualCoreCapture with 2 simulated cores in virtual
+ * time: the signal is defined on a fine time grid and the second core is sampling it with a known delay.
+ */
+#include "Arduino.h"
+#include "logic_analyzer.h"
+#include "capture_dual_core.h"
+#include "test.h"
+
+using namespace logic_analyzer;
+
+// resolution of the virtual time in steps per sampling period
+const int steps_per_period = 100;
+// number of entries (both cores)
+const size_t entries = 8000;
+
+/// random signal on 8 channels with a mean pulse length of 20 periods
+std::vector<PinBitArray> createSignal(size_t periods) {
+    std::vector<PinBitArray> result(periods * steps_per_period);
+    PinBitArray value = 0;
+    for (size_t j = 0; j < result.size(); j++) {
+        for (int ch = 0; ch < 8; ch++) {
+            if (rand() % (20 * steps_per_period) == 0) value ^= 1 << ch;
+        }
+        result[j] = value;
+    }
+    return result;
+}
+
+/// interleaved capture: the second core is delayed by delaySteps and its data is stored slotOffset periods later
+std::vector<PinBitArray> sample(const std::vector<PinBitArray> &signal, int delaySteps, int slotOffset) {
+    std::vector<PinBitArray> result(entries);
+    for (size_t j = 0; j < entries / 2; j++) {
+        result[2 * j] = signal[j * steps_per_period];
+        size_t odd = 2 * (j + slotOffset) + 1;
+        if (odd < entries) result[odd] = signal[j * steps_per_period + delaySteps];
+    }
+    // entries before the start of the second core
+    for (int j = 0; j < slotOffset; j++) {
+        result[2 * j + 1] = result[2 * j];
+    }
+    return result;
+}
+
+int main() {
+    srand(1);
+    std::vector<PinBitArray> signal = createSignal(entries / 2 + DUAL_CORE_MAX_SLOT_OFFSET + 1);
+    for (int slots = 0; slots <= 3; slots++) {
+        for (int phase_steps : {20, 50, 80}) {
+            int delay_steps = slots * steps_per_period + phase_steps;
+
+            // the lag in whole periods is detected from the spikes
+            std::vector<PinBitArray> raw = sample(signal, delay_steps, 0);
+            int offset = InterleavedPhase::slotOffset(raw.data(), raw.size());
+            printf("delay %d steps: slot offset %d\n", delay_steps, offset);
+            CHECK(offset == slots);
+
+            // after the correction of the slots we measure the phase
+            std::vector<PinBitArray> corrected = sample(signal, delay_steps, slots);
+            float phase = InterleavedPhase::phase(corrected.data(), corrected.size());
+            printf("delay %d steps: phase %f\n", delay_steps, phase);
+            CHECK(fabs(phase - phase_steps / (float)steps_per_period) < 0.05);
+        }
+    }
+
+    // no changes: no phase
+    std::vector<PinBitArray> constant(entries, 0x55);
+    CHECK(InterleavedPhase::phase(constant.data(), constant.size()) < 0);
+    return TEST_RESULT();
+}
@@ -0,0 +1,55 @@
+/**
+ * @file test_probes.cpp
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Host benchmark of the capture pipeline: runs a max speed and a paced capture with the cycle probes and
+ * prints the breakdown of the cycles per stage.
+ */
+#define LOGIC_ANALYZER_PROBES
+#include "Arduino.h"
+#include "logic_analyzer.h"
+#include "test.h"
+
+using namespace logic_analyzer;
+
+const size_t capture_size = 10000;
+
+/// Prints to stdout
+class ConsolePrint : public Print {
+    public:
+        size_t write(uint8_t c) override {
+            return fwrite(&c, 1, 1, stdout);
+        }
+};
+
+HostStream stream;
+ConsolePrint console;
+LogicAnalyzer logicAnalyzer;
+Capture capture(2000000, 600000);
+
+/// Captures and dumps capture_size entries at the indicated frequency and prints the breakdown
+void benchmark(uint64_t frequency) {
+    logicAnalyzer.setCaptureFrequency(frequency);
+    stream.out.clear();
+    probes().clear();
+    stream.in.push_back(SUMP_ARM);
+    logicAnalyzer.processCommand();
+    printf("capture of %lu entries at %lu hz:\n", (unsigned long) capture_size, (unsigned long) frequency);
+    probes().printTo(console);
+    CHECK(stream.out.size() == capture_size * sizeof(PinBitArray));
+    CHECK(probes().count(PROBE_READ) == capture_size);
+    CHECK(probes().count(PROBE_BUFFER_WRITE) == capture_size);
+    CHECK(probes().count(PROBE_OUTPUT) > 0);
+}
+
+int main() {
+    srand(1);
+    for (size_t j = 0; j < capture_size; j++) host_samples.push_back(rand());
+    logicAnalyzer.begin(stream, &capture, capture_size, 0, 8);
+    logicAnalyzer.setReadCount(capture_size);
+    logicAnalyzer.setDelayCount(capture_size);
+    // max speed and paced
+    benchmark(2000000);
+    benchmark(100000);
+    return TEST_RESULT();
+}
@@ -0,0 +1,110 @@
+/**
+ * @file test_setup_hold.cpp
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Feeds a synthetic clock and data waveform with known setup times, hold times and skews in blocks of random
+ * size to the SetupHoldChecker and compares the min setup, min hold, max skew and the violations with the expected
+ * values.
+ */
+#include "Arduino.h"
+#include "logic_analyzer.h"
+#include "capture_setup_hold.h"
+#include "test.h"
+
+using namespace logic_analyzer;
+
+const uint32_t period = 20;
+const uint32_t cycles = 200;
+const uint32_t setup_limit = 4;
+const uint32_t hold_limit = 6;
+
+/// expected violation
+struct ExpectedViolation {
+    uint32_t pos;
+    bool is_hold;
+};
+
+int main() {
+    srand(1);
+    // after an idle period the clock (channel 0) is rising in the middle of each period: data channel 1 changes
+    // lead samples before the edge and data channel 2 changes skew samples after channel 1
+    std::vector<PinBitArray> data((cycles + 2) * period);
+    std::vector<uint32_t> toggle1(data.size()), toggle2(data.size());
+    uint32_t min_setup = UINT32_MAX, min_hold = UINT32_MAX, max_skew = 0;
+    std::vector<ExpectedViolation> expected;
+    for (uint32_t k = 0; k < cycles; k++) {
+        uint32_t edge = (k + 1) * period + period / 2;
+        uint32_t lead = 2 + rand() % 15;
+        uint32_t skew = rand() % (lead + 1);
+        uint32_t change = edge - lead;
+        toggle1[change] = 1;
+        toggle2[change + skew] = 1;
+        // the hold time of the prior edge ends with the first change of this cycle
+        if (k > 0) {
+            uint32_t hold = change - (edge - period);
+            min_hold = std::min(min_hold, hold);
+            if (hold < hold_limit) expected.push_back({change, true});
+            // the skew of the first incomplete cycle is ignored
+            max_skew = std::max(max_skew, skew);
+        }
+        uint32_t setup = lead - skew;
+        min_setup = std::min(min_setup, setup);
+        if (setup < setup_limit) expected.push_back({edge, false});
+    }
+    PinBitArray bit1 = 0, bit2 = 0;
+    for (size_t j = 0; j < data.size(); j++) {
+        bit1 ^= toggle1[j];
+        bit2 ^= toggle2[j];
+        PinBitArray clock = j >= period && (j % period) >= period / 2;
+        data[j] = clock | bit1 << 1 | bit2 << 2;
+    }
+
+    SetupHoldChecker checker;
+    checker.setClock(0);
+    checker.setData(0x06);
+    checker.setLimits(setup_limit, hold_limit);
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t len = std::min<size_t>(1 + rand() % 64, data.size() - pos);
+        checker.add(data.data() + pos, len);
+        pos += len;
+    }
+    printf("min setup %lu, min hold %lu, max skew %lu, %lu setup and %lu hold violations\n", (unsigned long) checker.minSetup(),
+           (unsigned long) checker.minHold(), (unsigned long) checker.maxSkew(), (unsigned long) checker.setupViolations(),
+           (unsigned long) checker.holdViolations());
+    CHECK(checker.samples() == data.size());
+    CHECK(checker.minSetup() == min_setup);
+    CHECK(checker.minHold() == min_hold);
+    CHECK(checker.maxSkew() == max_skew);
+
+    uint32_t setup_violations = 0, hold_violations = 0;
+    for (auto &v : expected) {
+        if (v.is_hold) hold_violations++; else setup_violations++;
+    }
+    CHECK(checker.setupViolations() == setup_violations);
+    CHECK(checker.holdViolations() == hold_violations);
+
+    // the ring keeps the last violations from the oldest to the newest
+    CHECK(expected.size() > SETUP_HOLD_MAX_VIOLATIONS);
+    CHECK(checker.violationCount() == SETUP_HOLD_MAX_VIOLATIONS);
+    size_t first = expected.size() - SETUP_HOLD_MAX_VIOLATIONS;
+    for (size_t j = 0; j < checker.violationCount(); j++) {
+        CHECK(checker.violation(j).sample_pos == expected[first + j].pos);
+        CHECK(checker.violation(j).is_hold == expected[first + j].is_hold);
+    }
+
+    // with fewer violations than the ring size we start with the first one
+    checker.reset();
+    const size_t half = SETUP_HOLD_MAX_VIOLATIONS / 2;
+    checker.add(data.data(), expected[half - 1].pos + 1);
+    CHECK(checker.violationCount() == half);
+    for (size_t j = 0; j < checker.violationCount(); j++) {
+        CHECK(checker.violation(j).sample_pos == expected[j].pos);
+    }
+
+    // the result is sent with 7 header words and the kept violations
+    HostStream stream;
+    checker.writeTo(stream);
+    CHECK(stream.out.size() == (7 + checker.violationCount()) * sizeof(uint32_t));
+    return TEST_RESULT();
+}
@@ -0,0 +1,121 @@
+/**
+ * @file test_uart_decoder.cpp
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @brief Decodes a known serial stream with a fractional bit length which is split into blocks of all sizes, so 
+ * that the characters and bits are carried over the block boundaries. The same stream is also decoded during a 
+ * continuous capture.
+ */
+#include "Arduino.h"
+#include "logic_analyzer.h"
+#include "decoder_uart.h"
+#include "test.h"
+
+using namespace logic_analyzer;
+
+const float bit_length = 8.68f;
+
+/// Adds a character with start and stop bit followed by some idle time
+void addCharacter(std::vector<PinBitArray> &data, float &time, uint8_t value, bool stopBit = true) {
+    auto add = [&](bool level, float len) {
+        time += len;
+        while (data.size() < (size_t) time) data.push_back(level ? 1 : 0);
+    };
+    add(false, bit_length);
+    for (int bit = 0; bit < 8; bit++) add((value >> bit) & 1, bit_length);
+    add(stopBit, bit_length);
+    add(true, 3 * bit_length);
+}
+
+/// Stops the continuous capture with a RESET when the indicated number of bytes has been sent
+class LimitedStream : public HostStream {
+    public:
+        size_t limit = 0;
+        size_t write(uint8_t c) override {
+            return write(&c, 1);
+        }
+        size_t write(const uint8_t *data, size_t len) override {
+            HostStream::write(data, len);
+            if (out.size() >= limit && in.empty()) in.push_back(SUMP_RESET);
+            return len;
+        }
+        using Print::write;
+};
+
+/// Decodes the data in blocks of the indicated size
+DecoderEvents &decode(DecoderRegistry &registry, const std::vector<PinBitArray> &data, size_t blockSize) {
+    registry.events().clear();
+    registry.reset();
+    for (size_t pos = 0; pos < data.size(); pos += blockSize) {
+        size_t len = data.size() - pos < blockSize ? data.size() - pos : blockSize;
+        registry.decode(data.data() + pos, len);
+    }
+    return registry.events();
+}
+
+int main() {
+    // idle line followed by "Hi!" and a character w/o stop bit
+    std::vector<PinBitArray> data(20, 1);
+    float time = data.size();
+    std::vector<size_t> start_pos;
+    const char *text = "Hi!";
+    for (const char *ptr = text; *ptr; ptr++) {
+        start_pos.push_back(data.size());
+        addCharacter(data, time, *ptr);
+    }
+    start_pos.push_back(data.size());
+    addCharacter(data, time, 0x55, false);
+
+    UARTDecoder uart;
+    uart.setChannel(UART_RX, 0);
+    uart.setBitLength(bit_length);
+    DecoderRegistry registry;
+    registry.add(uart);
+
+    for (size_t block_size = 1; block_size <= data.size(); block_size++) {
+        DecoderEvents &events = decode(registry, data, block_size);
+        CHECK(events.size() == 4);
+        if (events.size() != 4) continue;
+        for (int j = 0; j < 3; j++) {
+            CHECK(events[j].type == UART_DATA);
+            CHECK(events[j].value == (uint8_t) text[j]);
+            CHECK(events[j].sample_pos == start_pos[j]);
+        }
+        CHECK(events[3].type == UART_FRAME_ERROR);
+        CHECK(events[3].value == 0x55);
+        CHECK(events[3].sample_pos == start_pos[3]);
+    }
+    printf("decoded %lu samples in all block sizes\n", (unsigned long) data.size());
+
+    // continuous capture with a buffer which is smaller than a block: the decoders are evaluating the sent samples
+    LimitedStream stream;
+    LogicAnalyzer logicAnalyzer;
+    Capture capture(2000000, 600000);
+    host_samples = data;
+    logicAnalyzer.begin(stream, &capture, 100, 0, 8);
+    logicAnalyzer.setDecoders(&registry);
+    for (uint64_t frequency : {2000000, 100000}) {
+        registry.events().clear();
+        host_pos = 0;
+        stream.out.clear();
+        stream.limit = 3 * data.size();
+        logicAnalyzer.setContinuousCapture(true);
+        logicAnalyzer.setCaptureFrequency(frequency);
+        stream.in.push_back(SUMP_ARM);
+        logicAnalyzer.processCommand();
+        std::vector<PinBitArray> sent(stream.out.begin(), stream.out.end());
+        std::vector<DecoderEvent> actual;
+        for (size_t j = 0; j < registry.events().size(); j++) actual.push_back(registry.events()[j]);
+        DecoderEvents &expected = decode(registry, sent, sent.size());
+        printf("continuous capture at %lu hz: %lu samples, %lu events\n", (unsigned long) frequency, (unsigned long) sent.size(),
+               (unsigned long) actual.size());
+        CHECK(sent.size() >= stream.limit);
+        CHECK(actual.size() == expected.size() && actual.size() >= 4);
+        for (size_t j = 0; j < actual.size() && j < expected.size(); j++) {
+            CHECK(actual[j].sample_pos == expected[j].sample_pos);
+            CHECK(actual[j].type == expected[j].type && actual[j].value == expected[j].value);
+        }
+        while (stream.available()) logicAnalyzer.processCommand();
+    }
+    return TEST_RESULT();
+}